@@ -30,6 +30,9 @@
 // Rekonq Includes
 #include "rekonq_defines.h"
 
+// Qt Includes
+#include <QDataStream>
+
 AdBlockElementHiding::AdBlockElementHiding()
 {
 }
@@ -65,15 +68,32 @@ bool AdBlockElementHiding::addRule(const QString &rule)
     return true;
 }
 
-void AdBlockElementHiding::apply(QWebElement &document, const QString &domain) const
+static void appendHidingRule(QString &styleSheet, const QString &rule)
 {
+    // one css rule per selector: an invalid one drops just itself.
+    // and don't let a selector break the stylesheet (or the style element)
+    if (rule.contains(QL1C('{')) || rule.contains(QL1C('}')) || rule.contains(QL1C('<')))
+        return;
+
+    styleSheet += rule;
+    styleSheet += QL1S(" { display: none !important; }\n");
+}
 
-    //first apply generic rules
+void AdBlockElementHiding::buildStyleSheet()
+{
+    QString styleSheet;
     Q_FOREACH(const QString &rule, m_GenericRules)
     {
-        applyStringRule(document, rule);
+        appendHidingRule(styleSheet, rule);
     }
 
+    m_GenericStyleSheet = styleSheet;
+}
+
+QString AdBlockElementHiding::domainStyleSheet(const QString &domain) const
+{
+    QString styleSheet;
+
     //check for whitelisted rules
     QStringList whiteListedRules;
     const QStringList subdomainList = generateSubdomainList(domain);
@@ -83,36 +103,44 @@ void AdBlockElementHiding::apply(QWebElement &document, const QString &domain) c
         whiteListedRules.append(m_DomainSpecificRulesWhitelist.values(d));
     }
 
-    //apply rules if not whitelisted
+    //add rules if not whitelisted
     Q_FOREACH(const QString &d, subdomainList)
     {
         const QList<QString> ruleList = m_DomainSpecificRules.values(d);
         Q_FOREACH(const QString &rule, ruleList)
         {
             if (!whiteListedRules.contains(rule))
-                applyStringRule(document, rule);
+                appendHidingRule(styleSheet, rule);
         }
     }
+
+    return styleSheet;
 }
 
 void AdBlockElementHiding::clear()
 {
     m_GenericRules.clear();
+    m_GenericStyleSheet.clear();
     m_DomainSpecificRules.clear();
     m_DomainSpecificRulesWhitelist.clear();
 }
 
-void AdBlockElementHiding::applyStringRule(QWebElement &document, const QString &rule) const
+void AdBlockElementHiding::merge(const AdBlockElementHiding &other)
 {
-    QWebElementCollection elements = document.findAll(rule);
+    m_GenericRules += other.m_GenericRules;
+    m_DomainSpecificRules.unite(other.m_DomainSpecificRules);
+    m_DomainSpecificRulesWhitelist.unite(other.m_DomainSpecificRulesWhitelist);
+}
 
-    Q_FOREACH(QWebElement el, elements)
-    {
-        if (el.isNull())
-            continue;
-        kDebug() << "Hide element: " << el.localName();
-        el.removeFromDocument();
-    }
+void AdBlockElementHiding::save(QDataStream &out) const
+{
+    out << m_GenericRules << m_DomainSpecificRules << m_DomainSpecificRulesWhitelist;
+}
+
+void AdBlockElementHiding::load(QDataStream &in)
+{
+    clear();
+    in >> m_GenericRules >> m_DomainSpecificRules >> m_DomainSpecificRulesWhitelist;
 }
 
 QStringList AdBlockElementHiding::generateSubdomainList(const QString &domain) const
@@ -28,7 +28,8 @@
 
 #include <QStringList>
 #include <QMultiHash>
-#include <QWebElement>
+
+class QDataStream;
 
 class AdBlockElementHiding
 {
@@ -36,15 +37,32 @@ public:
     AdBlockElementHiding();
 
     bool addRule(const QString &rule);
-    void apply(QWebElement &document, const QString &domain) const;
+
+    // Precompile generic rules in a stylesheet. To be called after rules are added
+    void buildStyleSheet();
+
+    // The stylesheet of the generic rules, the same for every page
+    QString genericStyleSheet() const
+    {
+        return m_GenericStyleSheet;
+    }
+
+    // The (usually small) stylesheet of the rules specific to domain
+    QString domainStyleSheet(const QString &domain) const;
 
     void clear();
 
+    // add all the rules of another one to this one. Stylesheet has to be built again
+    void merge(const AdBlockElementHiding &other);
+
+    void save(QDataStream &out) const;
+    void load(QDataStream &in);
+
 private:
-    void applyStringRule(QWebElement &document, const QString &rule) const;
     QStringList generateSubdomainList(const QString &domain) const;
 
     QStringList m_GenericRules;
+    QString m_GenericStyleSheet;
     QMultiHash<QString, QString> m_DomainSpecificRules;
     QMultiHash<QString, QString> m_DomainSpecificRulesWhitelist;
 };
@@ -31,25 +31,54 @@
 #include "rekonq_defines.h"
 
 
-bool AdBlockHostMatcher::tryAddFilter(const QString &filter)
+static bool isHostName(const QString &domain)
 {
-    if (filter.startsWith(QL1S("||")))
+    if (domain.isEmpty())
+        return false;
+
+    const QChar *data = domain.constData();
+    const int length = domain.length();
+    for (int i = 0; i < length; ++i)
     {
-        QString domain = filter.mid(2);
+        const QChar c = data[i];
+        if (!c.isLetterOrNumber() && c != QL1C('.') && c != QL1C('-') && c != QL1C('_'))
+            return false;
+    }
+    return true;
+}
+
 
-        if (!domain.endsWith(QL1C('^')))
+static bool isLowerCase(const QString &host)
+{
+    const QChar *data = host.constData();
+    const int length = host.length();
+    for (int i = 0; i < length; ++i)
+    {
+        if (data[i].isUpper())
             return false;
+    }
+    return true;
+}
 
-        if (domain.contains(QL1C('$')))
+
+bool AdBlockHostMatcher::tryAddFilter(const QString &filter)
+{
+    // ||domain^ and @@||domain^ rules (or ||domain/ ones).
+    // They match domain and all of its subdomains
+    const int anchorPosition = filter.startsWith(QL1S("@@")) ? 2 : 0;
+    if (filter.midRef(anchorPosition, 2) == QL1S("||"))
+    {
+        QString domain = filter.mid(anchorPosition + 2);
+
+        if (!domain.endsWith(QL1C('^')) && !domain.endsWith(QL1C('/')))
             return false;
 
-        domain = domain.left(domain.size() - 1);
+        domain.chop(1);
 
-        if (domain.contains(QL1C('/')) || domain.contains(QL1C('*')) || domain.contains(QL1C('^')))
+        if (!isHostName(domain))
             return false;
 
-        domain = domain.toLower();
-        m_hostList.insert(domain);
+        m_domainList.insert(domain.toLower());
         return true;
     }
 
@@ -69,11 +98,13 @@ bool AdBlockHostMatcher::tryAddFilter(const QString &filter)
         if (domain.contains(QL1C('|')))
             return false;
 
-        if (domain.contains(QL1C('/')))
-        {
-            if (!domain.endsWith(QL1C('/')))
-                return false;
-        }
+        if (domain.endsWith(QL1C('/')))
+            domain.chop(1);
+
+        // @@/path/, @@-advert- and the like are not hosts: leave them to the white rules
+        if (!isHostName(domain) || !domain.contains(QL1C('.')))
+            return false;
+
         domain = domain.toLower();
         m_hostList.insert(domain);
         return true;
@@ -81,3 +112,34 @@ bool AdBlockHostMatcher::tryAddFilter(const QString &filter)
 
     return false;
 }
+
+
+bool AdBlockHostMatcher::match(const QString &host) const
+{
+    // hosts from QUrl are already lowercase: copy them just when really needed
+    const QString lowerHost = isLowerCase(host) ? host : host.toLower();
+
+    if (m_hostList.contains(lowerHost))
+        return true;
+
+    if (m_domainList.isEmpty())
+        return false;
+
+    if (m_domainList.contains(lowerHost))
+        return true;
+
+    // walk parent domains, label by label, without copying strings around
+    const QChar *data = lowerHost.constData();
+    const int length = lowerHost.length();
+    for (int i = 0; i < length; ++i)
+    {
+        if (data[i] != QL1C('.'))
+            continue;
+
+        const QString domain = QString::fromRawData(data + i + 1, length - i - 1);
+        if (m_domainList.contains(domain))
+            return true;
+    }
+
+    return false;
+}
@@ -27,12 +27,15 @@
 #ifndef ADBLOCKHOSTMATCHER_H
 #define ADBLOCKHOSTMATCHER_H
 
+#include "rekonq_defines.h"
+
+#include <QDataStream>
 #include <QSet>
 #include <QString>
 
 #include <KDebug>
 
-class AdBlockHostMatcher
+class REKONQ_TESTS_EXPORT AdBlockHostMatcher
 {
 public:
     // Try to add an adblock filter to this host matcher.
@@ -40,18 +43,37 @@ public:
     // and the method return false;
     bool tryAddFilter(const QString &filter);
 
-    bool match(const QString &host) const
-    {
-        return m_hostList.contains(host.toLower());
-    }
+    // true if host, or one of its parent domains, is in the list
+    bool match(const QString &host) const;
 
     void clear()
     {
         m_hostList.clear();
+        m_domainList.clear();
+    }
+
+    void merge(const AdBlockHostMatcher &other)
+    {
+        m_hostList.unite(other.m_hostList);
+        m_domainList.unite(other.m_domainList);
+    }
+
+    void save(QDataStream &out) const
+    {
+        out << m_hostList << m_domainList;
+    }
+
+    void load(QDataStream &in)
+    {
+        in >> m_hostList >> m_domainList;
     }
 
 private:
+    // hosts matched exactly (@@host rules)
     QSet<QString> m_hostList;
+
+    // domains matched with all their subdomains (||domain^ rules)
+    QSet<QString> m_domainList;
 };
 
 #endif // ADBLOCKHOSTMATCHER_H
@@ -37,21 +37,66 @@
 #include "webpage.h"
 
 // KDE Includes
-#include <KIO/FileCopyJob>
+#include <KIO/Job>
+#include <KSaveFile>
 #include <KStandardDirs>
 
 // Qt Includes
 #include <QUrl>
 #include <QTimer>
-#include <QWebElement>
+#include <QCryptographicHash>
+#include <QWebSettings>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QWebElement>
+#include <QWebFrame>
+#include <QWebPage>
 #include <QtConcurrentRun>
 
 
 QWeakPointer<AdBlockManager> AdBlockManager::s_adBlockManager;
 
 
+// how many adblock decisions we remember
+static const int ADBLOCK_DECISION_CACHE_SIZE = 4096;
+
+
+static AdBlockDecisionKey decisionKey(const QNetworkRequest &request)
+{
+    AdBlockDecisionKey key;
+    key.url = request.url().toEncoded();
+    key.referer = request.rawHeader("referer");
+    key.contentType = AdBlockRequest::guessContentType(request);
+
+    // without a referer, the request origin is its frame. Frames can be in any page,
+    // and the page decides, too (@@...$document rules)
+    QWebFrame *frame = qobject_cast<QWebFrame *>(request.originatingObject());
+    if (frame && (key.referer.isEmpty() || frame->parentFrame()))
+    {
+        key.frameUrls = frame->url().toEncoded();
+        if (frame->page())
+            key.frameUrls += ' ' + frame->page()->mainFrame()->url().toEncoded();
+    }
+
+    return key;
+}
+
+
+// NOTE: rules come from third party lists: a stylesheet is set as the element text,
+// it is never parsed as markup (think of "##a</style><script>...")
+static void appendStyleElement(QWebElement &head, const QString &styleSheet)
+{
+    head.appendInside(QL1S("<style type=\"text/css\"></style>"));
+    head.lastChild().setPlainText(styleSheet);
+}
+
+
+static inline QString rulesCacheDirPath()
+{
+    return KStandardDirs::locateLocal("appdata" , QL1S("adblockcache/"));
+}
+
+
 AdBlockManager *AdBlockManager::self()
 {
     if (s_adBlockManager.isNull())
@@ -69,16 +114,26 @@ AdBlockManager::AdBlockManager(QObject *parent)
     : QObject(parent)
     , _isAdblockEnabled(false)
     , _isHideAdsEnabled(false)
+    , _isRebuildPending(false)
+    , _pendingUpdates(0)
+    , _subscriptionsChanged(false)
+    , _decisionCache(ADBLOCK_DECISION_CACHE_SIZE)
+    , _decisionCacheHits(0)
+    , _decisionCacheMisses(0)
 {
-    // NOTE: launch this in a second thread so that it does not delay startup
-    _settingsLoaded = QtConcurrent::run(this, &AdBlockManager::loadSettings);
+    connect(&_ruleSetWatcher, SIGNAL(finished()), this, SLOT(ruleSetBuilt()));
+
+    // NOTE: rules are now cached per list, in the adblockcache dir. Drop the old one
+    QFile::remove(KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_cache")));
+
+    // NOTE: this just reads settings. Rules are loaded in a second thread
+    // so that it does not delay startup
+    loadSettings();
 }
 
 
 AdBlockManager::~AdBlockManager()
 {
-    _whiteList.clear();
-    _blackList.clear();
 }
 
 
@@ -112,13 +167,11 @@ void AdBlockManager::loadSettings()
     _adblockConfig = KSharedConfig::openConfig("adblockrc", KConfig::SimpleConfig, "appdata");
     // ----------------
 
-    _hostWhiteList.clear();
-    _hostBlackList.clear();
+    _whiteReferers = ReKonfig::whiteReferer();
 
-    _whiteList.clear();
-    _blackList.clear();
-
-    _elementHiding.clear();
+    _rulesFiles.clear();
+    _pendingUpdates = 0;
+    _subscriptionsChanged = false;
 
     KConfigGroup settingsGroup(_adblockConfig, "Settings");
 
@@ -126,6 +179,8 @@ void AdBlockManager::loadSettings()
     if (!settingsGroup.readEntry("adBlockEnabled", false))
     {
         _isAdblockEnabled = false;
+        _ruleSet.clear();
+        clearDecisionCache();
         return;
     }
 
@@ -156,87 +211,61 @@ void AdBlockManager::loadSettings()
         if (!isFilterEnabled)
             continue;
 
+        // old rules are used until the updated ones arrive
         bool fileExists = subscriptionFileExists(i);
+        if (fileExists)
+        {
+            _rulesFiles << KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_") + n);
+        }
+
         if (allSubscriptionsNeedUpdate || !fileExists)
         {
             kDebug() << "FILE SHOULDN'T EXIST. updating subscription";
             updateSubscription(i);
         }
-        else
-        {
-            QString rulesFilePath = KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_") + n);
-            loadRules(rulesFilePath);
-        }
     }
 
-    // load local rules
-    QString localRulesFilePath = KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_local"));
-    loadRules(localRulesFilePath);
+    // local rules
+    _rulesFiles << KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_local"));
 
     _isAdblockEnabled = true;
+
+    rebuildRuleSet();
 }
 
 
-void AdBlockManager::loadRules(const QString &rulesFilePath)
+void AdBlockManager::rebuildRuleSet()
 {
-    QFile ruleFile(rulesFilePath);
-    if (!ruleFile.open(QFile::ReadOnly | QFile::Text))
+    // NOTE: just one build at a time, as builds write the list caches.
+    // A running build could have already read the old rules: build again when it finishes
+    if (_ruleSetWatcher.isRunning())
     {
-        kDebug() << "Unable to open rule file" << rulesFilePath;
+        _isRebuildPending = true;
         return;
     }
 
-    QTextStream in(&ruleFile);
-    while (!in.atEnd())
-    {
-        QString stringRule = in.readLine();
-        loadRuleString(stringRule);
-    }
+    _isRebuildPending = false;
+    _ruleSetWatcher.setFuture(QtConcurrent::run(&AdBlockRuleSet::build, _rulesFiles, rulesCacheDirPath()));
 }
 
 
-void AdBlockManager::loadRuleString(const QString &stringRule)
+void AdBlockManager::ruleSetBuilt()
 {
-    // ! rules are comments
-    if (stringRule.startsWith('!'))
-        return;
-
-    // [ rules are ABP info
-    if (stringRule.startsWith('['))
-        return;
-
-    // empty rules are just dangerous..
-    // (an empty rule in whitelist allows all, in blacklist blocks all..)
-    if (stringRule.isEmpty())
-        return;
-
-    // white rules
-    if (stringRule.startsWith(QL1S("@@")))
+    if (_isRebuildPending)
     {
-        if (_hostWhiteList.tryAddFilter(stringRule))
-            return;
-
-        const QString filter = stringRule.mid(2);
-        if (filter.isEmpty())
-            return;
-
-        AdBlockRule rule(filter);
-        _whiteList << rule;
+        rebuildRuleSet();
         return;
     }
 
-    // hide (CSS) rules
-    if (stringRule.contains(QL1S("##")))
-    {
-        _elementHiding.addRule(stringRule);
+    // adblock has been disabled while building
+    if (!_isAdblockEnabled)
         return;
-    }
 
-    if (_hostBlackList.tryAddFilter(stringRule))
-        return;
+    // here the new rule set replaces the old one, at once
+    _ruleSet = _ruleSetWatcher.result();
+    clearDecisionCache();
 
-    AdBlockRule rule(stringRule);
-    _blackList << rule;
+    kDebug() << "ADBLOCK: rules loaded in" << _ruleSet->loadingTime() << "ms";
 }
 
 
@@ -245,59 +274,49 @@ bool AdBlockManager::blockRequest(const QNetworkRequest &request)
     if (!_isAdblockEnabled)
         return false;
 
-    // we (ad)block just http & https traffic
-    if (request.url().scheme() != QL1S("http")
-            && request.url().scheme() != QL1S("https"))
+    // rules are still loading...
+    if (!_ruleSet)
         return false;
 
-    QStringList whiteRefererList = ReKonfig::whiteReferer();
-    const QString referer = request.rawHeader("referer");
-    Q_FOREACH(const QString & host, whiteRefererList)
-    {
-        if (referer.contains(host))
-            return false;
-    }
-
-    QString urlString = request.url().toString();
-    // We compute a lowercase version of the URL so each rule does not
-    // have to do it.
-    const QString urlStringLowerCase = urlString.toLower();
-    const QString host = request.url().host();
-
-    // check white rules before :)
-    if (_hostWhiteList.match(host))
-    {
-        kDebug() << "ADBLOCK: WHITE RULE (@@) Matched by string: " << urlString;
+    // we (ad)block just http & https traffic
+    const QString scheme = request.url().scheme();
+    if (scheme != QL1S("http") && scheme != QL1S("https"))
         return false;
-    }
 
-    Q_FOREACH(const AdBlockRule & filter, _whiteList)
+    if (!_whiteReferers.isEmpty())
     {
-        if (filter.match(request, urlString, urlStringLowerCase))
+        const QString referer = request.rawHeader("referer");
+        Q_FOREACH(const QString & host, _whiteReferers)
         {
-            kDebug() << "ADBLOCK: WHITE RULE (@@) Matched by string: " << urlString;
-            return false;
+            if (referer.contains(host))
+                return false;
         }
     }
 
-    // then check the black ones :(
-    if (_hostBlackList.match(host))
-    {
-        kDebug() << "ADBLOCK: BLACK RULE Matched by string: " << urlString;
-        return true;
-    }
+    // The same urls are requested again and again, from the same pages (trackers, reloads...).
+    // Everything rules look at is in the key, so a cached decision is always the right one
+    const AdBlockDecisionKey key = decisionKey(request);
 
-    Q_FOREACH(const AdBlockRule & filter, _blackList)
+    // NOTE: QCache drops the least recently used decisions. A bool is allocated
+    // just on a miss, when all the rules are matched anyway
+    const bool *cachedDecision = _decisionCache.object(key);
+    if (cachedDecision)
     {
-        if (filter.match(request, urlString, urlStringLowerCase))
-        {
-            kDebug() << "ADBLOCK: BLACK RULE Matched by string: " << urlString;
-            return true;
-        }
+        _decisionCacheHits++;
+        return *cachedDecision;
     }
+    _decisionCacheMisses++;
 
-    // no match
-    return false;
+    const bool blocked = _ruleSet->blockRequest(AdBlockRequest(request));
+    _decisionCache.insert(key, new bool(blocked));
+    return blocked;
+}
+
+
+void AdBlockManager::clearDecisionCache()
+{
+    kDebug() << "Clearing adblock decision cache. Hits:" << _decisionCacheHits << "misses:" << _decisionCacheMisses;
+    _decisionCache.clear();
 }
 
 
@@ -309,29 +328,77 @@ void AdBlockManager::updateSubscription(int i)
     const QString fUrl = filtersGroup.readEntry("FilterURL-" + n, QString());
     KUrl subUrl = KUrl(fUrl);
 
-    QString rulesFilePath = KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_") + n);
-    KUrl destUrl = KUrl(rulesFilePath);
-
-    KIO::FileCopyJob* job = KIO::file_copy(subUrl , destUrl, -1, KIO::HideProgressInfo | KIO::Overwrite);
+    KIO::StoredTransferJob* job = KIO::storedGet(subUrl, KIO::Reload, KIO::HideProgressInfo);
     job->metaData().insert("ssl_no_client_cert", "TRUE");
     job->metaData().insert("ssl_no_ui", "TRUE");
     job->metaData().insert("UseCache", "false");
     job->metaData().insert("cookies", "none");
     job->metaData().insert("no-auth", "true");
+    job->setProperty("subscription", i);
 
     connect(job, SIGNAL(finished(KJob*)), this, SLOT(slotFinished(KJob*)));
+    _pendingUpdates++;
 }
 
 
 void AdBlockManager::slotFinished(KJob *job)
 {
-    if (job->error())
-        return;
+    if (_pendingUpdates > 0)
+        _pendingUpdates--;
 
-    KIO::FileCopyJob *fJob = qobject_cast<KIO::FileCopyJob *>(job);
-    KUrl url = fJob->destUrl();
-    url.setProtocol(QString()); // this is needed to load local url well :(
-    loadRules(url.url());
+    KIO::StoredTransferJob *sJob = qobject_cast<KIO::StoredTransferJob *>(job);
+    if (sJob && !sJob->error())
+    {
+        const int i = sJob->property("subscription").toInt();
+        if (saveSubscription(i, sJob->data()))
+            _subscriptionsChanged = true;
+    }
+
+    // rebuild rules once, when all subscriptions have been updated
+    if (_pendingUpdates == 0 && _subscriptionsChanged)
+    {
+        _subscriptionsChanged = false;
+        rebuildRuleSet();
+    }
+}
+
+
+bool AdBlockManager::saveSubscription(int i, const QByteArray &data)
+{
+    if (data.isEmpty())
+        return false;
+
+    const QString n = QString::number(i + 1);
+    const QString rulesFilePath = KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_") + n);
+
+    // lists change a lot less often than we check them: do nothing if this one did not
+    KConfigGroup filtersGroup(_adblockConfig, "FiltersList");
+    const QString hash = QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    if (hash == filtersGroup.readEntry("FilterHash-" + n, QString()) && QFile::exists(rulesFilePath))
+    {
+        kDebug() << "ADBLOCK: subscription" << n << "did not change";
+        return false;
+    }
+
+    KSaveFile rulesFile(rulesFilePath);
+    if (!rulesFile.open(QIODevice::WriteOnly))
+    {
+        kDebug() << "Unable to open rule file" << rulesFilePath;
+        return false;
+    }
+    rulesFile.write(data);
+    if (!rulesFile.finalize())
+    {
+        kDebug() << "Unable to save rule file" << rulesFilePath;
+        return false;
+    }
+
+    filtersGroup.writeEntry("FilterHash-" + n, hash);
+
+    if (!_rulesFiles.contains(rulesFilePath))
+        _rulesFiles << rulesFilePath;
+
+    return true;
 }
 
 
@@ -346,9 +413,6 @@ bool AdBlockManager::subscriptionFileExists(int i)
 
 void AdBlockManager::showSettings()
 {
-    // at this point, the settings should be loaded
-    _settingsLoaded.waitForFinished();
-
     QPointer<KDialog> dialog = new KDialog();
     dialog->setCaption(i18nc("@title:window", "Ad Block Settings"));
     dialog->setButtons(KDialog::Ok | KDialog::Cancel);
@@ -365,9 +429,6 @@ void AdBlockManager::showSettings()
 
 void AdBlockManager::addCustomRule(const QString &stringRule, bool reloadPage)
 {
-    // at this point, the settings should be loaded
-    _settingsLoaded.waitForFinished();
-
     // save rule in local filters
     const QString localRulesFilePath = KStandardDirs::locateLocal("appdata" , QL1S("adblockrules_local"));
 
@@ -383,8 +444,17 @@ void AdBlockManager::addCustomRule(const QString &stringRule, bool reloadPage)
 
     ruleFile.close();
 
-    // load it
-    loadRuleString(stringRule);
+    // load it now: copy (cheap: implicitly shared data), add the rule and swap
+    if (_ruleSet)
+    {
+        AdBlockRuleSetPtr ruleSet(new AdBlockRuleSet(*_ruleSet));
+        ruleSet->addCustomRule(stringRule);
+        _ruleSet = ruleSet;
+        clearDecisionCache();
+    }
+
+    // then build again: just the local rules are parsed, and their cache updated
+    rebuildRuleSet();
 
     // eventually reload page
     if (reloadPage)
@@ -397,7 +467,22 @@ bool AdBlockManager::isAdblockEnabledForHost(const QString &host)
     if (!_isAdblockEnabled)
         return false;
 
-    return ! _hostWhiteList.match(host);
+    if (!_ruleSet)
+        return true;
+
+    return ! _ruleSet->isHostWhiteListed(host);
+}
+
+
+void AdBlockManager::setAdblockEnabledForSite(const QString &host, bool enabled)
+{
+    if (enabled)
+        _whiteReferers.removeOne(host);
+    else if (!_whiteReferers.contains(host))
+        _whiteReferers << host;
+
+    ReKonfig::setWhiteReferer(_whiteReferers);
+    clearDecisionCache();
 }
 
 
@@ -406,16 +491,14 @@ void AdBlockManager::applyHidingRules(QWebFrame *frame)
     if (!frame)
         return;
 
-    if (!_isAdblockEnabled)
-        return;
-
-    connect(frame, SIGNAL(loadFinished(bool)), this, SLOT(applyHidingRules(bool)));
+    // NOTE: the rules are added to every document loaded in the frame, as soon as it is laid out
+    connect(frame, SIGNAL(initialLayoutCompleted()), this, SLOT(applyHidingRules()));
 }
 
 
-void AdBlockManager::applyHidingRules(bool ok)
+void AdBlockManager::applyHidingRules()
 {
-    if (!ok)
+    if (!_isAdblockEnabled || !_ruleSet)
         return;
 
     QWebFrame *frame = qobject_cast<QWebFrame *>(sender());
@@ -427,11 +510,20 @@ void AdBlockManager::applyHidingRules(bool ok)
         return;
 
     QString mainPageHost = page->loadingUrl().host();
-    QStringList hosts = ReKonfig::whiteReferer();
-    if (hosts.contains(mainPageHost))
+    if (_whiteReferers.contains(mainPageHost) || _ruleSet->isPageWhiteListed(page->loadingUrl()))
+        return;
+
+    QWebElement head = frame->documentElement().findFirst(QL1S("head"));
+    if (head.isNull())
         return;
 
-    QWebElement document = frame->documentElement();
+    // The hiding rules go in the document, as style elements: the user stylesheet stays
+    // the user one. The generic sheet is built once with the rule set and just added as is,
+    // the domain specific one has the few rules of this host only
+    const AdBlockElementHiding &elementHiding = _ruleSet->elementHiding();
+    appendStyleElement(head, elementHiding.genericStyleSheet());
 
-    _elementHiding.apply(document, mainPageHost);
+    const QString domainStyleSheet = elementHiding.domainStyleSheet(mainPageHost);
+    if (!domainStyleSheet.isEmpty())
+        appendStyleElement(head, domainStyleSheet);
 }
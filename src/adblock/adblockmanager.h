@@ -125,26 +125,53 @@
 #include "rekonq_defines.h"
 
 // Local Includes
-#include "adblockelementhiding.h"
-#include "adblockhostmatcher.h"
-#include "adblockrule.h"
+#include "adblockruleset.h"
 
 // KDE Includes
 #include <KIO/Job>
 #include <KSharedConfig>
+#include <KUrl>
 
 // Qt Includes
 #include <QObject>
 #include <QStringList>
 #include <QByteArray>
-#include <QFuture>
+#include <QCache>
+#include <QHash>
+#include <QFutureWatcher>
 
 // Forward Includes
 class QNetworkRequest;
 class QWebFrame;
 
-// Definitions
-typedef QList<AdBlockRule> AdBlockRuleList;
+
+// What an adblock decision depends on: the request url and type and the page
+// it comes from. Cheaper to get than an AdBlockRequest, as most requests
+// find their decision already taken.
+struct AdBlockDecisionKey
+{
+    QByteArray url;
+    QByteArray referer;
+
+    // the frame (and page) urls, when the referer does not tell everything
+    QByteArray frameUrls;
+
+    int contentType;
+
+    bool operator==(const AdBlockDecisionKey &other) const
+    {
+        return contentType == other.contentType
+               && url == other.url
+               && referer == other.referer
+               && frameUrls == other.frameUrls;
+    }
+};
+
+
+inline uint qHash(const AdBlockDecisionKey &key)
+{
+    return qHash(key.url) ^ qHash(key.referer) ^ qHash(key.frameUrls) ^ uint(key.contentType);
+}
 
 
 class REKONQ_TESTS_EXPORT AdBlockManager : public QObject
@@ -170,17 +197,38 @@ public:
 
     bool isAdblockEnabledForHost(const QString &host);
 
+    // enable or disable adblock on the pages of a site (the white referers list)
+    void setAdblockEnabledForSite(const QString &host, bool enabled);
+
+    // decision cache counters, for debugging
+    qint64 decisionCacheHits() const
+    {
+        return _decisionCacheHits;
+    }
+
+    qint64 decisionCacheMisses() const
+    {
+        return _decisionCacheMisses;
+    }
+
+public Q_SLOTS:
+    // hide ad elements in every document the frame will load
+    void applyHidingRules(QWebFrame *);
+
 private:
     AdBlockManager(QObject *parent = 0);
 
     void updateSubscription(int);
     bool subscriptionFileExists(int);
 
-    // load a file rule, given a path
-    void loadRules(const QString &rulesFilePath);
+    // save a downloaded subscription, if its content changed
+    bool saveSubscription(int, const QByteArray &data);
 
-    // load a single rule
-    void loadRuleString(const QString &stringRule);
+    // build a fresh rule set from _rulesFiles, in a worker thread
+    void rebuildRuleSet();
+
+    // to be called every time rules change
+    void clearDecisionCache();
 
 private Q_SLOTS:
     void loadSettings();
@@ -188,8 +236,9 @@ private Q_SLOTS:
 
     void slotFinished(KJob *);
 
-    void applyHidingRules(QWebFrame *);
-    void applyHidingRules(bool);
+    void ruleSetBuilt();
+
+    void applyHidingRules();
 
 Q_SIGNALS:
     void reloadCurrentPage();
@@ -198,15 +247,25 @@ private:
     bool _isAdblockEnabled;
     bool _isHideAdsEnabled;
 
-    AdBlockHostMatcher _hostBlackList;
-    AdBlockHostMatcher _hostWhiteList;
-    AdBlockRuleList _blackList;
-    AdBlockRuleList _whiteList;
-
-    AdBlockElementHiding _elementHiding;
+    // The rules in use. NEVER modify it: build a new one and swap them.
+    AdBlockRuleSetPtr _ruleSet;
+    QFutureWatcher<AdBlockRuleSetPtr> _ruleSetWatcher;
+    bool _isRebuildPending;
 
     KSharedConfig::Ptr _adblockConfig;
-    QFuture<void> _settingsLoaded;
+
+    // the rule files the rule set is built from and the subscriptions still downloading
+    QStringList _rulesFiles;
+    int _pendingUpdates;
+    bool _subscriptionsChanged;
+
+    // sites adblock is disabled on, as from ReKonfig::whiteReferer()
+    QStringList _whiteReferers;
+
+    // latest decisions taken, least recently used ones dropped first
+    QCache<AdBlockDecisionKey, bool> _decisionCache;
+    qint64 _decisionCacheHits;
+    qint64 _decisionCacheMisses;
 
     static QWeakPointer<AdBlockManager> s_adBlockManager;
 };
@@ -0,0 +1,186 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Self Includes
+#include "adblockrequest.h"
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Qt Includes
+#include <QUrl>
+#include <QWebFrame>
+#include <QWebPage>
+
+
+AdBlockRequest::AdBlockRequest(const QNetworkRequest &request)
+    : m_request(request)
+    , m_urlString(request.url().toString())
+    , m_host(request.url().host())
+    , m_contentType(OtherContent)
+    , m_isThirdParty(-1)
+{
+    const QString referer = QString::fromLatin1(request.rawHeader("referer"));
+
+    QWebFrame *frame = qobject_cast<QWebFrame *>(request.originatingObject());
+    if (frame)
+    {
+        const QUrl frameUrl = frame->url();
+        m_originHost = frameUrl.host();
+        m_firstPartyUrl = frameUrl;
+    }
+
+    if (!referer.isEmpty())
+    {
+        m_firstPartyUrl = QUrl(referer);
+        if (m_originHost.isEmpty())
+            m_originHost = m_firstPartyUrl.host();
+    }
+
+    m_contentType = guessContentType(request);
+
+    if (m_contentType == DocumentContent)
+        m_pageUrl = request.url();
+    else if (frame && frame->page())
+        m_pageUrl = frame->page()->mainFrame()->url();
+    else
+        m_pageUrl = m_firstPartyUrl;
+}
+
+
+bool AdBlockRequest::isThirdParty() const
+{
+    if (m_isThirdParty == -1)
+    {
+        // pages (and requests with no known origin) are always first party
+        if (m_firstPartyUrl.isEmpty() || m_contentType == DocumentContent)
+        {
+            m_isThirdParty = 0;
+        }
+        else
+        {
+            const QString requestDomain = registrableDomain(m_request.url());
+            const QString originDomain = registrableDomain(m_firstPartyUrl);
+            m_isThirdParty = (requestDomain.compare(originDomain, Qt::CaseInsensitive) != 0) ? 1 : 0;
+        }
+    }
+    return m_isThirdParty == 1;
+}
+
+
+QString AdBlockRequest::registrableDomain(const QUrl &url)
+{
+    const QString host = url.host();
+
+    // NOTE: topLevelDomain() knows about the public suffixes (.co.uk, .blogspot.com...)
+    // and returns an empty string for ip addresses and unknown tlds
+    const QString tld = url.topLevelDomain();
+    if (tld.isEmpty())
+        return host;
+
+    const int tldPosition = host.length() - tld.length();
+    if (tldPosition <= 0)
+        return host;
+
+    const int dotPosition = host.lastIndexOf(QL1C('.'), tldPosition - 1);
+    return host.mid(dotPosition + 1);
+}
+
+
+AdBlockRequest::ContentType AdBlockRequest::guessContentType(const QNetworkRequest &request)
+{
+    // we look at what WebKit accepts for the request, at the headers and at the url extension
+    const QByteArray accept = request.rawHeader("Accept");
+
+    // NOTE: before the Accept checks, as scripts can ask html pages, too
+    if (request.rawHeader("X-Requested-With") == "XMLHttpRequest")
+        return XmlHttpRequestContent;
+
+    if (accept.startsWith("text/html") || accept.contains("application/xhtml+xml"))
+    {
+        QWebFrame *frame = qobject_cast<QWebFrame *>(request.originatingObject());
+        if (frame && frame->parentFrame())
+            return SubdocumentContent;
+        return DocumentContent;
+    }
+
+    if (accept.startsWith("text/css"))
+        return StyleSheetContent;
+
+    if (accept.startsWith("image/"))
+        return ImageContent;
+
+    if (accept.startsWith("video/") || accept.startsWith("audio/"))
+        return MediaContent;
+
+    const QString scheme = request.url().scheme();
+    if (scheme == QL1S("ws") || scheme == QL1S("wss"))
+        return WebSocketContent;
+
+    const QString path = request.url().path().toLower();
+
+    if (path.endsWith(QL1S(".js")))
+        return ScriptContent;
+
+    if (path.endsWith(QL1S(".css")))
+        return StyleSheetContent;
+
+    if (path.endsWith(QL1S(".png"))
+            || path.endsWith(QL1S(".gif"))
+            || path.endsWith(QL1S(".jpg"))
+            || path.endsWith(QL1S(".jpeg"))
+            || path.endsWith(QL1S(".ico"))
+            || path.endsWith(QL1S(".svg"))
+            || path.endsWith(QL1S(".webp")))
+        return ImageContent;
+
+    if (path.endsWith(QL1S(".swf"))
+            || path.endsWith(QL1S(".flv"))
+            || path.endsWith(QL1S(".jar"))
+            || path.endsWith(QL1S(".class")))
+        return ObjectContent;
+
+    if (path.endsWith(QL1S(".mp3"))
+            || path.endsWith(QL1S(".mp4"))
+            || path.endsWith(QL1S(".m4a"))
+            || path.endsWith(QL1S(".m4v"))
+            || path.endsWith(QL1S(".ogg"))
+            || path.endsWith(QL1S(".oga"))
+            || path.endsWith(QL1S(".ogv"))
+            || path.endsWith(QL1S(".opus"))
+            || path.endsWith(QL1S(".wav"))
+            || path.endsWith(QL1S(".webm")))
+        return MediaContent;
+
+    if (path.endsWith(QL1S(".woff"))
+            || path.endsWith(QL1S(".woff2"))
+            || path.endsWith(QL1S(".ttf"))
+            || path.endsWith(QL1S(".otf"))
+            || path.endsWith(QL1S(".eot")))
+        return FontContent;
+
+    return OtherContent;
+}
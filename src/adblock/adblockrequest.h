@@ -0,0 +1,145 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+#ifndef ADBLOCKREQUEST_H
+#define ADBLOCKREQUEST_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Qt Includes
+#include <QNetworkRequest>
+#include <QString>
+#include <QUrl>
+
+
+// A network request, as seen by the adblock rules.
+// Everything rules need (url strings, content type, origin...) is computed
+// here once per request, instead of once per rule.
+class REKONQ_TESTS_EXPORT AdBlockRequest
+{
+public:
+    // NOTE: these are flags, as rules store the set of types they apply to
+    enum ContentType
+    {
+        OtherContent            = 0x0001,
+        ScriptContent           = 0x0002,
+        ImageContent            = 0x0004,
+        StyleSheetContent       = 0x0008,
+        ObjectContent           = 0x0010,
+        XmlHttpRequestContent   = 0x0020,
+        ObjectSubrequestContent = 0x0040,
+        SubdocumentContent      = 0x0080,
+        DocumentContent         = 0x0100,
+        MediaContent            = 0x0200,
+        FontContent             = 0x0400,
+        WebSocketContent        = 0x0800,
+        WebRtcContent           = 0x1000,
+
+        // NOTE: QtWebKit does not tell popups apart, no request has this type
+        PopupContent            = 0x2000,
+
+        AllContents             = 0x3FFF
+    };
+
+    explicit AdBlockRequest(const QNetworkRequest &request);
+
+    const QNetworkRequest &request() const
+    {
+        return m_request;
+    }
+
+    const QString &urlString() const
+    {
+        return m_urlString;
+    }
+
+    // We compute a lowercase version of the URL so each rule does not have to do it.
+    // NOTE: computed on first use, as cached decisions do not need it
+    const QString &urlStringLowerCase() const
+    {
+        if (m_urlStringLowerCase.isEmpty())
+            m_urlStringLowerCase = m_urlString.toLower();
+        return m_urlStringLowerCase;
+    }
+
+    const QString &host() const
+    {
+        return m_host;
+    }
+
+    // the host of the page (frame) the request comes from
+    const QString &originHost() const
+    {
+        return m_originHost;
+    }
+
+    // the host of the page third-party checks are done against
+    QString firstPartyHost() const
+    {
+        return m_firstPartyUrl.host();
+    }
+
+    // the (top level) page the request is done for, the request itself for pages
+    const QUrl &pageUrl() const
+    {
+        return m_pageUrl;
+    }
+
+    ContentType contentType() const
+    {
+        return m_contentType;
+    }
+
+    // true if the request goes to a different (registrable) domain than the
+    // one of the page it comes from
+    bool isThirdParty() const;
+
+    // example.com for www.example.com, example.co.uk for ads.example.co.uk
+    static QString registrableDomain(const QUrl &url);
+
+    // QtWebKit does not tell us what a request is for: guess it
+    static ContentType guessContentType(const QNetworkRequest &request);
+
+private:
+
+    QNetworkRequest m_request;
+
+    QString m_urlString;
+    mutable QString m_urlStringLowerCase;
+    QString m_host;
+    QString m_originHost;
+    QUrl m_firstPartyUrl;
+    QUrl m_pageUrl;
+
+    ContentType m_contentType;
+
+    // computed on first use: many requests never reach a third-party rule
+    mutable int m_isThirdParty;
+};
+
+#endif // ADBLOCKREQUEST_H
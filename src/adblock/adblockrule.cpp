@@ -35,7 +35,8 @@
 #include "adblockruletextmatchimpl.h"
 
 
-AdBlockRule::AdBlockRule(const QString &filter)
+AdBlockRule::AdBlockRule(const QString &filter, const QString &compiledPattern)
+    : m_filter(filter)
 {
     switch (AdBlockRule::ruleType(filter))
     {
@@ -44,7 +45,7 @@ AdBlockRule::AdBlockRule(const QString &filter)
         break;
 
     case FallbackRule:
-        m_implementation = QSharedPointer<AdBlockRuleImpl>(new AdBlockRuleFallbackImpl(filter));
+        m_implementation = QSharedPointer<AdBlockRuleImpl>(new AdBlockRuleFallbackImpl(filter, compiledPattern));
         break;
 
     case NullRule:
@@ -32,11 +32,13 @@
 #include "rekonq_defines.h"
 
 #include "adblockruleimpl.h"
+#include "adblockrequest.h"
+
+#include <KDebug>
 
 #include <QSharedPointer>
 
 // Forward Includes
-class QNetworkRequest;
 class QString;
 
 
@@ -48,15 +50,16 @@ enum RuleTypes
 };
 
 
-class AdBlockRule
+class REKONQ_TESTS_EXPORT AdBlockRule
 {
 public:
-    explicit AdBlockRule(const QString &filter);
+    // compiledPattern is the ruleString() of an already built rule with the same filter.
+    // It lets us skip the (slow) pattern conversion when loading rules from cache
+    explicit AdBlockRule(const QString &filter, const QString &compiledPattern = QString());
 
-    bool match(const QNetworkRequest &request, const QString &encodedUrl, const QString &encodedUrlLowerCase) const
+    bool match(const AdBlockRequest &request) const
     {
-        Q_ASSERT(encodedUrl.toLower() == encodedUrlLowerCase);
-        bool b = m_implementation->match(request, encodedUrl, encodedUrlLowerCase);
+        bool b = m_implementation->match(request);
         if (b)
         {
             kDebug() << m_implementation->ruleType() << ": rule string = " << m_implementation->ruleString();
@@ -64,9 +67,20 @@ public:
         return b;
     }
 
+    QString filter() const
+    {
+        return m_filter;
+    }
+
+    QString ruleString() const
+    {
+        return m_implementation->ruleString();
+    }
+
     static RuleTypes ruleType(const QString &filter);
 
 private:
+    QString m_filter;
     QSharedPointer<AdBlockRuleImpl> m_implementation;
 };
 
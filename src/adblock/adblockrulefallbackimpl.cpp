@@ -31,9 +31,10 @@
 // Rekonq Includes
 #include "rekonq_defines.h"
 
+// Local Includes
+#include "adblockrequest.h"
+
 // Qt Includes
-#include <QWebFrame>
-#include <QNetworkReply>
 #include <QStringList>
 
 
@@ -44,8 +45,61 @@ static inline bool isRegExpFilter(const QString &filter)
 }
 
 
-AdBlockRuleFallbackImpl::AdBlockRuleFallbackImpl(const QString &filter)
+static int contentTypeFromOption(const QString &option)
+{
+    if (option == QL1S("script"))
+        return AdBlockRequest::ScriptContent;
+
+    if (option == QL1S("image") || option == QL1S("background"))
+        return AdBlockRequest::ImageContent;
+
+    if (option == QL1S("stylesheet"))
+        return AdBlockRequest::StyleSheetContent;
+
+    if (option == QL1S("object"))
+        return AdBlockRequest::ObjectContent;
+
+    if (option == QL1S("xmlhttprequest"))
+        return AdBlockRequest::XmlHttpRequestContent;
+
+    if (option == QL1S("object-subrequest"))
+        return AdBlockRequest::ObjectSubrequestContent;
+
+    if (option == QL1S("subdocument"))
+        return AdBlockRequest::SubdocumentContent;
+
+    if (option == QL1S("document"))
+        return AdBlockRequest::DocumentContent;
+
+    if (option == QL1S("media"))
+        return AdBlockRequest::MediaContent;
+
+    if (option == QL1S("font"))
+        return AdBlockRequest::FontContent;
+
+    if (option == QL1S("websocket"))
+        return AdBlockRequest::WebSocketContent;
+
+    if (option == QL1S("webrtc"))
+        return AdBlockRequest::WebRtcContent;
+
+    if (option == QL1S("popup"))
+        return AdBlockRequest::PopupContent;
+
+    // we cannot tell these ones apart, in QtWebKit
+    if (option == QL1S("other")
+            || option == QL1S("xbl")
+            || option == QL1S("ping")
+            || option == QL1S("dtd"))
+        return AdBlockRequest::OtherContent;
+
+    return 0;
+}
+
+
+AdBlockRuleFallbackImpl::AdBlockRuleFallbackImpl(const QString &filter, const QString &regExpPattern)
     : AdBlockRuleImpl(filter)
+    , m_contentTypes(AdBlockRequest::AllContents & ~(AdBlockRequest::DocumentContent | AdBlockRequest::PopupContent))
     , m_unsupported(false)
     , m_thirdPartyOption(false)
     , m_thirdPartyOptionReversed(false)
@@ -57,102 +111,148 @@ AdBlockRuleFallbackImpl::AdBlockRuleFallbackImpl(const QString &filter)
 
     if (isRegExpFilter(parsedLine))
     {
-        parsedLine = parsedLine.mid(1, parsedLine.length() - 2);        
+        parsedLine = parsedLine.mid(1, parsedLine.length() - 2);
     }
     else
     {
         const int optionsNumber = parsedLine.lastIndexOf(QL1C('$'));
-    
+
         if (optionsNumber >= 0)
         {
-            QStringList options(parsedLine.mid(optionsNumber + 1).split(QL1C(',')));
+            const QStringList options(parsedLine.mid(optionsNumber + 1).split(QL1C(',')));
             parsedLine = parsedLine.left(optionsNumber);
 
-            if (options.removeOne(QL1S("match-case")))
-                m_regExp.setCaseSensitivity(Qt::CaseSensitive);
-
-            if (options.removeOne(QL1S("third-party")))
-                m_thirdPartyOption = true;
+            int includedTypes = 0;
+            int excludedTypes = 0;
 
-            if (options.removeOne(QL1S("~third-party")))
-            {
-                m_thirdPartyOption = true;
-                m_thirdPartyOptionReversed = true;
-            }
-            
             Q_FOREACH(const QString & option, options)
             {
+                if (option == QL1S("match-case"))
+                {
+                    m_regExp.setCaseSensitivity(Qt::CaseSensitive);
+                    continue;
+                }
+
+                if (option == QL1S("third-party"))
+                {
+                    m_thirdPartyOption = true;
+                    continue;
+                }
+
+                if (option == QL1S("~third-party"))
+                {
+                    m_thirdPartyOption = true;
+                    m_thirdPartyOptionReversed = true;
+                    continue;
+                }
+
                 // Domain restricted filter
                 const QString domainKeyword(QL1S("domain="));
                 if (option.startsWith(domainKeyword))
                 {
-                    options.removeOne(option);
                     QStringList domainList = option.mid(domainKeyword.length()).split(QL1C('|'));
                     Q_FOREACH(const QString & domain, domainList)
                     {
                         if (domain.startsWith(QL1C('~')))
-                            m_whiteDomains.insert(domain.toLower());
+                            m_whiteDomains.insert(domain.mid(1).toLower());
                         else
                             m_blackDomains.insert(domain.toLower());
                     }
-                    break;
+                    continue;
+                }
+
+                // just a matter of how blocked elements are shown
+                if (option == QL1S("collapse") || option == QL1S("~collapse"))
+                    continue;
+
+                const bool inverse = option.startsWith(QL1C('~'));
+                const int type = contentTypeFromOption(inverse ? option.mid(1) : option);
+
+                // if we don't know an option we have to whitelist the rule
+                // to not be too much restrictive on adblocking
+                if (type == 0)
+                {
+                    m_unsupported = true;
+                    continue;
                 }
+
+                if (inverse)
+                    excludedTypes |= type;
+                else
+                    includedTypes |= type;
             }
-            
-            // if there are yet options available we have to whitelist the rule
-            // to not be too much restrictive on adblocking
-            m_unsupported = (!options.isEmpty());
+
+            if (includedTypes != 0)
+                m_contentTypes = includedTypes;
+            m_contentTypes &= ~excludedTypes;
         }
-        
-        parsedLine = convertPatternToRegExp(parsedLine);
+
+        if (regExpPattern.isEmpty())
+            parsedLine = convertPatternToRegExp(parsedLine);
+        else
+            parsedLine = regExpPattern;
     }
 
     m_regExp.setPattern(parsedLine);
 }
 
 
-bool AdBlockRuleFallbackImpl::match(const QNetworkRequest &request, const QString &encodedUrl, const QString &) const
+bool AdBlockRuleFallbackImpl::match(const AdBlockRequest &request) const
 {
     if (m_unsupported)
         return false;
-    
+
+    // cheap checks first, regexp at last
+    if (!(m_contentTypes & request.contentType()))
+        return false;
+
     if (m_thirdPartyOption)
     {
-        const QString referer = request.rawHeader("referer");
-        const QString host = request.url().host();
+        const bool isThirdParty = request.isThirdParty();
 
-        bool isThirdParty = !referer.contains(host);
-        
         if (!m_thirdPartyOptionReversed && !isThirdParty)
             return false;
-        
+
         if (m_thirdPartyOptionReversed && isThirdParty)
             return false;
     }
 
-    const bool regexpMatch = m_regExp.indexIn(encodedUrl) != -1;
+    if (!isOriginDomainAllowed(request.originHost()))
+        return false;
+
+    return m_regExp.indexIn(request.urlString()) != -1;
+}
+
 
-    if (regexpMatch && (!m_whiteDomains.isEmpty() || !m_blackDomains.isEmpty()))
+bool AdBlockRuleFallbackImpl::isOriginDomainAllowed(const QString &originHost) const
+{
+    if (m_whiteDomains.isEmpty() && m_blackDomains.isEmpty())
+        return true;
+
+    // The most specific domain listed decides, walking from the host up to its parent
+    // domains: domain=example.com|~foo.example.com applies on bar.example.com
+    // but not on foo.example.com
+    const QString host = originHost.toLower();
+    int position = 0;
+    while (position < host.length())
     {
-        Q_ASSERT(qobject_cast<QWebFrame*>(request.originatingObject()));
-        const QWebFrame *const origin = static_cast<QWebFrame * const>(request.originatingObject());
+        const QString domain = QString::fromRawData(host.constData() + position, host.length() - position);
 
-        const QString originDomain = origin->url().host();
+        if (m_whiteDomains.contains(domain))
+            return false;
 
-        if (!m_whiteDomains.isEmpty())
-        {
-            // In this context, white domains means we block anything but what is in the list.
-            if (m_whiteDomains.contains(originDomain))
-                return false;
+        if (m_blackDomains.contains(domain))
             return true;
-        }
-        else if (m_blackDomains.contains(originDomain))
-        {
-            return true;
-        }
-        return false;
+
+        position = host.indexOf(QL1C('.'), position);
+        if (position == -1)
+            break;
+        position++;
     }
-    return regexpMatch;
+
+    // nothing found: a rule restricted to some domains does not apply,
+    // one just excluding some domains does
+    return m_blackDomains.isEmpty();
 }
 
 
@@ -37,9 +37,10 @@
 class AdBlockRuleFallbackImpl : public AdBlockRuleImpl
 {
 public:
-    explicit AdBlockRuleFallbackImpl(const QString &filter);
+    // regExpPattern, if given, is the already converted pattern of filter
+    explicit AdBlockRuleFallbackImpl(const QString &filter, const QString &regExpPattern = QString());
     
-    bool match(const QNetworkRequest &request, const QString &encodedUrl, const QString &encodedUrlLowerCase) const;
+    bool match(const AdBlockRequest &request) const;
 
     QString ruleString() const;
     QString ruleType() const;
@@ -47,10 +48,18 @@ public:
 private:
     QString convertPatternToRegExp(const QString &wildcardPattern);
 
+    bool isOriginDomainAllowed(const QString &originHost) const;
+
     QRegExp m_regExp;
+
+    // domain= option: domains the rule is restricted to (black)
+    // or that are excluded from it (white, ~domain)
     QSet<QString> m_whiteDomains;
     QSet<QString> m_blackDomains;
 
+    // AdBlockRequest::ContentType flags the rule applies to
+    int m_contentTypes;
+
     bool m_unsupported;
     bool m_thirdPartyOption;
     bool m_thirdPartyOptionReversed;
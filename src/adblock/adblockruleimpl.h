@@ -27,7 +27,7 @@
 #define ADBLOCKRULEIMPL_H
 
 class QString;
-class QNetworkRequest;
+class AdBlockRequest;
 
 class AdBlockRuleImpl
 {
@@ -35,7 +35,7 @@ public:
     explicit AdBlockRuleImpl(const QString &) {}
     virtual ~AdBlockRuleImpl() {}
     
-    virtual bool match(const QNetworkRequest &request, const QString &encodedUrl, const QString &encodedUrlLowerCase) const = 0;
+    virtual bool match(const AdBlockRequest &request) const = 0;
 
     // This are added just for debugging purposes
     virtual QString ruleString() const = 0;
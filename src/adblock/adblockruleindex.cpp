@@ -0,0 +1,291 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Self Includes
+#include "adblockruleindex.h"
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Qt Includes
+#include <QDataStream>
+#include <QIODevice>
+
+
+static inline bool isTokenChar(const QChar &c)
+{
+    const ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= '0' && u <= '9') || u == '%';
+}
+
+
+static void saveRuleList(QDataStream &out, const AdBlockRuleList &list)
+{
+    out << quint32(list.count());
+    Q_FOREACH(const AdBlockRule & rule, list)
+    {
+        out << rule.filter() << rule.ruleString();
+    }
+}
+
+
+// Counts are read from a file: check there is room for that many items
+// before allocating anything for them
+static bool isCountValid(QDataStream &in, quint32 count, int minimumItemSize)
+{
+    if (!in.device() || count > in.device()->bytesAvailable() / minimumItemSize)
+    {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+    return true;
+}
+
+
+static AdBlockRuleList loadRuleList(QDataStream &in)
+{
+    AdBlockRuleList list;
+
+    quint32 count;
+    in >> count;
+
+    // a rule is two strings, at least their sizes are there
+    if (!isCountValid(in, count, 2 * sizeof(quint32)))
+        return list;
+
+    list.reserve(count);
+
+    QString filter;
+    QString ruleString;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        in >> filter >> ruleString;
+        list << AdBlockRule(filter, ruleString);
+    }
+    return list;
+}
+
+
+AdBlockRuleIndex::AdBlockRuleIndex()
+    : m_count(0)
+{
+}
+
+
+void AdBlockRuleIndex::addRule(const QString &filter)
+{
+    // null rules never match: no need to store them
+    if (AdBlockRule::ruleType(filter) == NullRule)
+        return;
+
+    AdBlockRule rule(filter);
+    m_count++;
+
+    const QString token = tokenForFilter(filter);
+    if (token.isEmpty())
+    {
+        m_unindexedRules << rule;
+        return;
+    }
+
+    m_index[token] << rule;
+}
+
+
+bool AdBlockRuleIndex::match(const AdBlockRequest &request) const
+{
+    const QString &urlStringLowerCase = request.urlStringLowerCase();
+    const QChar *data = urlStringLowerCase.constData();
+    const int length = urlStringLowerCase.length();
+
+    int i = 0;
+    while (i < length)
+    {
+        if (!isTokenChar(data[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        const int start = i;
+        while (i < length && isTokenChar(data[i]))
+            ++i;
+
+        // NOTE: no copies here, the token just points into the url string
+        const QString token = QString::fromRawData(data + start, i - start);
+        QHash<QString, AdBlockRuleList>::const_iterator it = m_index.constFind(token);
+        if (it == m_index.constEnd())
+            continue;
+
+        if (matchList(it.value(), request))
+            return true;
+    }
+
+    return matchList(m_unindexedRules, request);
+}
+
+
+void AdBlockRuleIndex::clear()
+{
+    m_index.clear();
+    m_unindexedRules.clear();
+    m_count = 0;
+}
+
+
+void AdBlockRuleIndex::merge(const AdBlockRuleIndex &other)
+{
+    // the first merged index is just copied (implicitly shared)
+    if (m_count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    QHash<QString, AdBlockRuleList>::const_iterator it = other.m_index.constBegin();
+    for (; it != other.m_index.constEnd(); ++it)
+    {
+        m_index[it.key()] += it.value();
+    }
+
+    m_unindexedRules += other.m_unindexedRules;
+    m_count += other.m_count;
+}
+
+
+void AdBlockRuleIndex::save(QDataStream &out) const
+{
+    out << qint32(m_count);
+
+    out << quint32(m_index.count());
+    QHash<QString, AdBlockRuleList>::const_iterator it = m_index.constBegin();
+    for (; it != m_index.constEnd(); ++it)
+    {
+        out << it.key();
+        saveRuleList(out, it.value());
+    }
+
+    saveRuleList(out, m_unindexedRules);
+}
+
+
+void AdBlockRuleIndex::load(QDataStream &in)
+{
+    clear();
+
+    qint32 count;
+    in >> count;
+    m_count = count;
+
+    quint32 tokens;
+    in >> tokens;
+
+    // a token and the size of its rule list, at least
+    if (!isCountValid(in, tokens, 2 * sizeof(quint32)))
+        return;
+
+    m_index.reserve(tokens);
+
+    QString token;
+    for (quint32 i = 0; i < tokens && in.status() == QDataStream::Ok; ++i)
+    {
+        in >> token;
+        m_index.insert(token, loadRuleList(in));
+    }
+
+    m_unindexedRules = loadRuleList(in);
+}
+
+
+bool AdBlockRuleIndex::matchList(const AdBlockRuleList &list, const AdBlockRequest &request) const
+{
+    AdBlockRuleList::const_iterator it = list.constBegin();
+    AdBlockRuleList::const_iterator end = list.constEnd();
+    for (; it != end; ++it)
+    {
+        if ((*it).match(request))
+            return true;
+    }
+    return false;
+}
+
+
+QString AdBlockRuleIndex::tokenForFilter(const QString &filter) const
+{
+    // regexp rules cannot be reliably tokenized
+    if (filter.startsWith(QL1C('/')) && filter.endsWith(QL1C('/')))
+        return QString();
+
+    QString pattern = filter;
+
+    const int optionsNumber = pattern.lastIndexOf(QL1C('$'));
+    if (optionsNumber >= 0)
+        pattern = pattern.left(optionsNumber);
+
+    pattern = pattern.toLower();
+
+    // A token is a valid index key just if it is delimited on both sides by
+    // something that is not a wildcard (a separator, an anchor or any other
+    // literal char), so that it will be a whole token in the matched urls, too.
+    // Between the candidates, we choose the one with the fewer rules already
+    // stored under, preferring the longer one on ties.
+    QString bestToken;
+    int bestCount = 0;
+
+    const int length = pattern.length();
+    int i = 0;
+    while (i < length)
+    {
+        if (!isTokenChar(pattern.at(i)))
+        {
+            ++i;
+            continue;
+        }
+
+        const int start = i;
+        while (i < length && isTokenChar(pattern.at(i)))
+            ++i;
+
+        if (start == 0 || pattern.at(start - 1) == QL1C('*'))
+            continue;
+
+        if (i == length || pattern.at(i) == QL1C('*'))
+            continue;
+
+        const QString token = pattern.mid(start, i - start);
+        const int count = m_index.value(token).count();
+
+        if (bestToken.isEmpty()
+                || count < bestCount
+                || (count == bestCount && token.length() > bestToken.length()))
+        {
+            bestToken = token;
+            bestCount = count;
+        }
+    }
+
+    return bestToken;
+}
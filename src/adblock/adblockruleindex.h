@@ -0,0 +1,90 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+#ifndef ADBLOCKRULEINDEX_H
+#define ADBLOCKRULEINDEX_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockrule.h"
+
+// Qt Includes
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Forward Includes
+class QDataStream;
+
+
+typedef QList<AdBlockRule> AdBlockRuleList;
+
+
+// Keyword index of adblock rules.
+//
+// Every rule is stored under one "token": a run of [a-z0-9%] characters
+// taken from the filter text that is guaranteed to show up, as a whole
+// token, in every url the rule can match. Matching an url then means
+// splitting it in tokens and checking just the rules stored under them,
+// plus the (few) rules we were not able to find a token for.
+class REKONQ_TESTS_EXPORT AdBlockRuleIndex
+{
+public:
+    AdBlockRuleIndex();
+
+    void addRule(const QString &filter);
+
+    bool match(const AdBlockRequest &request) const;
+
+    void clear();
+
+    // add all the rules of another index to this one
+    void merge(const AdBlockRuleIndex &other);
+
+    // (de)serialize the whole index, to skip rules parsing at startup
+    void save(QDataStream &out) const;
+    void load(QDataStream &in);
+
+    int count() const
+    {
+        return m_count;
+    }
+
+private:
+    QString tokenForFilter(const QString &filter) const;
+
+    bool matchList(const AdBlockRuleList &list, const AdBlockRequest &request) const;
+
+    QHash<QString, AdBlockRuleList> m_index;
+    AdBlockRuleList m_unindexedRules;
+
+    int m_count;
+};
+
+#endif // ADBLOCKRULEINDEX_H
@@ -40,7 +40,7 @@ AdBlockRuleNullImpl::AdBlockRuleNullImpl(const QString &filter)
 }
 
 
-bool AdBlockRuleNullImpl::match(const QNetworkRequest &, const QString &, const QString &) const
+bool AdBlockRuleNullImpl::match(const AdBlockRequest &) const
 {
     return false;
 }
@@ -48,78 +48,45 @@ bool AdBlockRuleNullImpl::match(const QNetworkRequest &, const QString &, const
 
 bool AdBlockRuleNullImpl::isNullFilter(const QString &filter)
 {
-    QString parsedLine = filter;
+    // regexp rules have no options
+    if (filter.startsWith(QL1C('/')) && filter.endsWith(QL1C('/')))
+        return false;
 
-    const int optionsNumber = parsedLine.lastIndexOf(QL1C('$'));
-    if (optionsNumber == 0)
+    const int optionsNumber = filter.lastIndexOf(QL1C('$'));
+    if (optionsNumber <= 0)
         return false;
 
-    const QStringList options(parsedLine.mid(optionsNumber + 1).split(QL1C(',')));
+    const QStringList options(filter.mid(optionsNumber + 1).split(QL1C(',')));
 
     Q_FOREACH(const QString & option, options)
     {
         // NOTE:
-        // I moved the check from option == QL1S to option.endsWith()
-        // to check option && ~option. Hope it will NOT be a problem...
-
-        // third_party: managed inside adblockrulefallbackimpl
-        if (option.endsWith(QL1S("third-party")))
-            return false;
-
-        // script
-        if (option.endsWith(QL1S("script")))
-            return true;
-
-        // image
-        if (option.endsWith(QL1S("image")))
-            return true;
-
-        // background
-        if (option.endsWith(QL1S("background")))
-            return true;
-
-        // stylesheet
-        if (option.endsWith(QL1S("stylesheet")))
-            return true;
-
-        // object
-        if (option.endsWith(QL1S("object")))
-            return true;
-
-        // xbl
-        if (option.endsWith(QL1S("xbl")))
-            return true;
-
-        // ping
-        if (option.endsWith(QL1S("ping")))
-            return true;
-
-        // xmlhttprequest
-        if (option.endsWith(QL1S("xmlhttprequest")))
-            return true;
+        // content type, third-party and domain options are managed inside
+        // adblockrulefallbackimpl. These ones are about element hiding or
+        // change responses instead of blocking them: they cannot match here.
 
-        // object_subrequest
-        if (option.endsWith(QL1S("object-subrequest")))
+        // csp
+        if (option == QL1S("csp") || option.startsWith(QL1S("csp=")))
             return true;
 
-        // dtd
-        if (option.endsWith(QL1S("dtd")))
+        // rewrite
+        if (option.startsWith(QL1S("rewrite=")))
             return true;
 
-        // subdocument
-        if (option.endsWith(QL1S("subdocument")))
+        // sitekey: we cannot check the page signature
+        if (option.startsWith(QL1S("sitekey=")))
             return true;
 
-        // document
-        if (option.endsWith(QL1S("document")))
+        // elemhide
+        if (option.endsWith(QL1S("elemhide")))
             return true;
 
-        // other
-        if (option.endsWith(QL1S("other")))
+        // generichide
+        if (option.endsWith(QL1S("generichide")))
             return true;
 
-        // collapse
-        if (option.endsWith(QL1S("collapse")))
+        // genericblock
+        if (option.endsWith(QL1S("genericblock")))
             return true;
     }
 
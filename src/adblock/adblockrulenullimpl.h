@@ -41,7 +41,7 @@ class AdBlockRuleNullImpl : public AdBlockRuleImpl
 public:
     explicit AdBlockRuleNullImpl(const QString &filter);
     
-    bool match(const QNetworkRequest &, const QString &, const QString &) const;
+    bool match(const AdBlockRequest &) const;
 
     static bool isNullFilter(const QString &filter);
 
@@ -0,0 +1,360 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Self Includes
+#include "adblockruleset.h"
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// KDE Includes
+#include <KSaveFile>
+
+// Qt Includes
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkRequest>
+#include <QTextStream>
+
+
+// NOTE: bump this every time the cache layout (or the way rules are parsed) changes
+static const quint32 ADBLOCK_CACHE_MAGIC = 0x524b4142;   // "RKAB"
+static const quint32 ADBLOCK_CACHE_VERSION = 6;
+
+
+// Size and modification time of a rule file: tells if a cache has been built from it
+static QByteArray rulesFileStamp(const QString &rulesFilePath)
+{
+    QByteArray stamp;
+    QDataStream out(&stamp, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_8);
+
+    QFileInfo info(rulesFilePath);
+    out << rulesFilePath << qint64(info.exists() ? info.size() : -1) << info.lastModified();
+    return stamp;
+}
+
+
+// the cache of a rule file, in the cache dir
+static inline QString rulesCacheFilePath(const QString &rulesFilePath, const QString &cacheDirPath)
+{
+    return QDir(cacheDirPath).filePath(QFileInfo(rulesFilePath).fileName() + QL1S(".cache"));
+}
+
+
+// @@...$document rules whitelist whole pages: they are checked against page urls.
+// Returns the filter to check pages with (just the options about them), or an empty string
+static QString pageWhiteListFilter(const QString &filter)
+{
+    // regexp rules have no options
+    if (filter.startsWith(QL1C('/')) && filter.endsWith(QL1C('/')))
+        return QString();
+
+    const int optionsNumber = filter.lastIndexOf(QL1C('$'));
+    if (optionsNumber < 0)
+        return QString();
+
+    QStringList options = filter.mid(optionsNumber + 1).split(QL1C(','));
+    if (!options.contains(QL1S("document")))
+        return QString();
+
+    // these are about element hiding, not about what is loaded
+    options.removeAll(QL1S("elemhide"));
+    options.removeAll(QL1S("generichide"));
+    options.removeAll(QL1S("genericblock"));
+
+    return filter.left(optionsNumber + 1) + options.join(QL1S(","));
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+AdBlockRuleSet::AdBlockRuleSet()
+    : m_loadingTime(0)
+{
+}
+
+
+AdBlockRuleSetPtr AdBlockRuleSet::build(const QStringList &rulesFiles, const QString &cacheDirPath)
+{
+    QElapsedTimer loadingTimer;
+    loadingTimer.start();
+
+    AdBlockRuleSetPtr ruleSet(new AdBlockRuleSet);
+
+    // Every rule file has its own precompiled cache: just the changed ones are parsed again
+    Q_FOREACH(const QString & rulesFilePath, rulesFiles)
+    {
+        const QString cacheFilePath = rulesCacheFilePath(rulesFilePath, cacheDirPath);
+
+        // NOTE: files are stamped before reading them. If one changes while we parse it,
+        // the cache will look outdated next time, instead of silently missing the changes
+        const QByteArray stamp = rulesFileStamp(rulesFilePath);
+
+        AdBlockRuleSet fileRuleSet;
+        if (!fileRuleSet.loadCache(cacheFilePath, stamp))
+        {
+            fileRuleSet.loadRules(rulesFilePath);
+            fileRuleSet.saveCache(cacheFilePath, stamp);
+        }
+
+        ruleSet->merge(fileRuleSet);
+    }
+
+    ruleSet->m_elementHiding.buildStyleSheet();
+
+    ruleSet->m_loadingTime = loadingTimer.elapsed();
+    return ruleSet;
+}
+
+
+void AdBlockRuleSet::loadRules(const QString &rulesFilePath)
+{
+    QFile ruleFile(rulesFilePath);
+    if (!ruleFile.open(QFile::ReadOnly | QFile::Text))
+    {
+        kDebug() << "Unable to open rule file" << rulesFilePath;
+        return;
+    }
+
+    QTextStream in(&ruleFile);
+    while (!in.atEnd())
+    {
+        QString stringRule = in.readLine();
+        loadRuleString(stringRule);
+    }
+}
+
+
+void AdBlockRuleSet::loadRuleString(const QString &stringRule)
+{
+    // ! rules are comments
+    if (stringRule.startsWith('!'))
+        return;
+
+    // [ rules are ABP info
+    if (stringRule.startsWith('['))
+        return;
+
+    // empty rules are just dangerous..
+    // (an empty rule in whitelist allows all, in blacklist blocks all..)
+    if (stringRule.isEmpty())
+        return;
+
+    // white rules
+    if (stringRule.startsWith(QL1S("@@")))
+    {
+        if (m_hostWhiteList.tryAddFilter(stringRule))
+            return;
+
+        const QString filter = stringRule.mid(2);
+        if (filter.isEmpty())
+            return;
+
+        const QString pageFilter = pageWhiteListFilter(filter);
+        if (!pageFilter.isEmpty())
+            m_pageWhiteList.addRule(pageFilter);
+
+        m_whiteList.addRule(filter);
+        return;
+    }
+
+    // hide (CSS) rules
+    if (stringRule.contains(QL1S("##")))
+    {
+        m_elementHiding.addRule(stringRule);
+        return;
+    }
+
+    if (m_hostBlackList.tryAddFilter(stringRule))
+        return;
+
+    m_blackList.addRule(stringRule);
+}
+
+
+void AdBlockRuleSet::addCustomRule(const QString &stringRule)
+{
+    loadRuleString(stringRule);
+
+    if (stringRule.startsWith(QL1S("##")))
+        m_elementHiding.buildStyleSheet();
+}
+
+
+void AdBlockRuleSet::merge(const AdBlockRuleSet &other)
+{
+    m_hostWhiteList.merge(other.m_hostWhiteList);
+    m_hostBlackList.merge(other.m_hostBlackList);
+    m_whiteList.merge(other.m_whiteList);
+    m_pageWhiteList.merge(other.m_pageWhiteList);
+    m_blackList.merge(other.m_blackList);
+    m_elementHiding.merge(other.m_elementHiding);
+}
+
+
+bool AdBlockRuleSet::loadCache(const QString &cacheFilePath, const QByteArray &rulesFileStamp)
+{
+    QFile cacheFile(cacheFilePath);
+    if (!cacheFile.open(QFile::ReadOnly))
+        return false;
+
+    // map the cache, instead of reading it. Fall back to a full read if not possible
+    QByteArray data;
+    const uchar *mappedData = cacheFile.map(0, cacheFile.size());
+    if (mappedData)
+        data = QByteArray::fromRawData(reinterpret_cast<const char *>(mappedData), cacheFile.size());
+    else
+        data = cacheFile.readAll();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_8);
+
+    quint32 magic;
+    quint32 version;
+    in >> magic >> version;
+    if (magic != ADBLOCK_CACHE_MAGIC || version != ADBLOCK_CACHE_VERSION)
+    {
+        kDebug() << "ADBLOCK: rules cache has a different version. Discarding it";
+        return false;
+    }
+
+    // check the cache has been generated from the rule file we are going to load
+    QByteArray cachedStamp;
+    in >> cachedStamp;
+    if (cachedStamp != rulesFileStamp)
+    {
+        kDebug() << "ADBLOCK: rules cache is outdated. Discarding it";
+        return false;
+    }
+
+    m_hostWhiteList.load(in);
+    m_hostBlackList.load(in);
+    m_whiteList.load(in);
+    m_pageWhiteList.load(in);
+    m_blackList.load(in);
+    m_elementHiding.load(in);
+
+    if (in.status() != QDataStream::Ok)
+    {
+        kDebug() << "ADBLOCK: rules cache is corrupted. Discarding it";
+        m_hostWhiteList.clear();
+        m_hostBlackList.clear();
+        m_whiteList.clear();
+        m_pageWhiteList.clear();
+        m_blackList.clear();
+        m_elementHiding.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+void AdBlockRuleSet::saveCache(const QString &cacheFilePath, const QByteArray &rulesFileStamp) const
+{
+    // KSaveFile writes a temp file and renames it on finalize: a crash will not leave
+    // a truncated cache around
+    KSaveFile cacheFile(cacheFilePath);
+    if (!cacheFile.open(QIODevice::WriteOnly))
+    {
+        kDebug() << "Unable to open rules cache file" << cacheFilePath;
+        return;
+    }
+
+    QDataStream out(&cacheFile);
+    out.setVersion(QDataStream::Qt_4_8);
+
+    out << ADBLOCK_CACHE_MAGIC << ADBLOCK_CACHE_VERSION;
+    out << rulesFileStamp;
+
+    m_hostWhiteList.save(out);
+    m_hostBlackList.save(out);
+    m_whiteList.save(out);
+    m_pageWhiteList.save(out);
+    m_blackList.save(out);
+    m_elementHiding.save(out);
+
+    if (!cacheFile.finalize())
+        kDebug() << "Unable to save rules cache file" << cacheFilePath;
+}
+
+
+bool AdBlockRuleSet::blockRequest(const AdBlockRequest &request) const
+{
+    // whitelisted pages load everything
+    if (isPageWhiteListed(request.pageUrl()))
+    {
+        kDebug() << "ADBLOCK: WHITE PAGE (@@...$document) for request: " << request.urlString();
+        return false;
+    }
+
+    // check white rules before :)
+    if (m_hostWhiteList.match(request.host()))
+    {
+        kDebug() << "ADBLOCK: WHITE RULE (@@) Matched by string: " << request.urlString();
+        return false;
+    }
+
+    if (m_whiteList.match(request))
+    {
+        kDebug() << "ADBLOCK: WHITE RULE (@@) Matched by string: " << request.urlString();
+        return false;
+    }
+
+    // then check the black ones :(
+    if (m_hostBlackList.match(request.host()))
+    {
+        kDebug() << "ADBLOCK: BLACK RULE Matched by string: " << request.urlString();
+        return true;
+    }
+
+    if (m_blackList.match(request))
+    {
+        kDebug() << "ADBLOCK: BLACK RULE Matched by string: " << request.urlString();
+        return true;
+    }
+
+    // no match
+    return false;
+}
+
+
+bool AdBlockRuleSet::isPageWhiteListed(const QUrl &pageUrl) const
+{
+    if (m_pageWhiteList.count() == 0 || pageUrl.isEmpty())
+        return false;
+
+    // check the page as it is loaded
+    QNetworkRequest pageRequest(pageUrl);
+    pageRequest.setRawHeader("Accept", "text/html");
+
+    return m_pageWhiteList.match(AdBlockRequest(pageRequest));
+}
@@ -0,0 +1,121 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+#ifndef ADBLOCKRULESET_H
+#define ADBLOCKRULESET_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockelementhiding.h"
+#include "adblockhostmatcher.h"
+#include "adblockruleindex.h"
+
+// Qt Includes
+#include <QSharedPointer>
+#include <QStringList>
+#include <QUrl>
+
+
+// All the adblock rules, as loaded from a set of rule files.
+//
+// A rule set is built once (usually in a worker thread) and then published
+// to the AdBlockManager, which never changes it again: a new set is built
+// instead every time rules change, so that requests never see a half built one.
+class REKONQ_TESTS_EXPORT AdBlockRuleSet
+{
+public:
+    AdBlockRuleSet();
+
+    // Build a rule set from the given rule files, using (and refreshing) their
+    // precompiled caches, in cacheDirPath. Thread safe: meant to be run with QtConcurrent,
+    // but never run two builds on the same cache dir at once
+    static QSharedPointer<AdBlockRuleSet> build(const QStringList &rulesFiles, const QString &cacheDirPath);
+
+    // load a file rule, given a path
+    void loadRules(const QString &rulesFilePath);
+
+    // load a single rule
+    void loadRuleString(const QString &stringRule);
+
+    // load a single rule, in an already built set
+    void addCustomRule(const QString &stringRule);
+
+    // add all the rules of another set to this one
+    void merge(const AdBlockRuleSet &other);
+
+    // precompiled rules cache of a single rule file, valid just for the given stamp of it
+    bool loadCache(const QString &cacheFilePath, const QByteArray &rulesFileStamp);
+    void saveCache(const QString &cacheFilePath, const QByteArray &rulesFileStamp) const;
+
+    bool blockRequest(const AdBlockRequest &request) const;
+
+    bool isHostWhiteListed(const QString &host) const
+    {
+        return m_hostWhiteList.match(host);
+    }
+
+    // true if a @@...$document rule disables adblock on the page
+    bool isPageWhiteListed(const QUrl &pageUrl) const;
+
+    const AdBlockElementHiding &elementHiding() const
+    {
+        return m_elementHiding;
+    }
+
+    int blackRulesCount() const
+    {
+        return m_blackList.count();
+    }
+
+    int whiteRulesCount() const
+    {
+        return m_whiteList.count();
+    }
+
+    qint64 loadingTime() const
+    {
+        return m_loadingTime;
+    }
+
+private:
+    AdBlockHostMatcher m_hostBlackList;
+    AdBlockHostMatcher m_hostWhiteList;
+    AdBlockRuleIndex m_blackList;
+    AdBlockRuleIndex m_whiteList;
+    AdBlockRuleIndex m_pageWhiteList;
+
+    AdBlockElementHiding m_elementHiding;
+
+    qint64 m_loadingTime;
+};
+
+
+typedef QSharedPointer<AdBlockRuleSet> AdBlockRuleSetPtr;
+
+#endif // ADBLOCKRULESET_H
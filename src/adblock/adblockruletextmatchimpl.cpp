@@ -31,8 +31,8 @@
 // Rekonq Includes
 #include "rekonq_defines.h"
 
-// Qt Includes
-#include <QNetworkRequest>
+// Local Includes
+#include "adblockrequest.h"
 
 
 AdBlockRuleTextMatchImpl::AdBlockRuleTextMatchImpl(const QString &filter)
@@ -45,18 +45,20 @@ AdBlockRuleTextMatchImpl::AdBlockRuleTextMatchImpl(const QString &filter)
 }
 
 
-bool AdBlockRuleTextMatchImpl::match(const QNetworkRequest &request, const QString &encodedUrl, const QString &encodedUrlLowerCase) const
+bool AdBlockRuleTextMatchImpl::match(const AdBlockRequest &request) const
 {
-    Q_UNUSED(request);
-    Q_UNUSED(encodedUrl);
     if (m_textToMatch.isEmpty())
         return false;
-    
+
+    // as all the rules with no type options, these ones do not apply to pages
+    if (request.contentType() & (AdBlockRequest::DocumentContent | AdBlockRequest::PopupContent))
+        return false;
+
     // Case sensitive compare is faster, but would be incorrect with encodedUrl since
     // we do want case insensitive.
     // What we do is work on a lowercase version of m_textToMatch, and compare to the lowercase
     // version of encodedUrl.
-    return encodedUrlLowerCase.contains(m_textToMatch, Qt::CaseSensitive);
+    return request.urlStringLowerCase().contains(m_textToMatch, Qt::CaseSensitive);
 }
 
 
@@ -40,7 +40,7 @@ class AdBlockRuleTextMatchImpl : public AdBlockRuleImpl
 public:
     explicit AdBlockRuleTextMatchImpl(const QString &filter);
     
-    bool match(const QNetworkRequest &request, const QString &encodedUrl, const QString &encodedUrlLowerCase) const;
+    bool match(const AdBlockRequest &request) const;
 
     static bool isTextMatchFilter(const QString &filter);
 
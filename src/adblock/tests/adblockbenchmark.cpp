@@ -0,0 +1,380 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockrequest.h"
+#include "adblockruleset.h"
+
+// KDE Includes
+#include <KTempDir>
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QElapsedTimer>
+#include <QFile>
+#include <QNetworkRequest>
+#include <QTextStream>
+#include <QVector>
+#include <QtTest>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+
+// NOTE
+// The benchmark runs on a generated list and corpus, EasyList sized: the bundled
+// snapshot (a hand trimmed EasyList, with its urls) is just for the decisions check.
+
+// rules in the generated list, about as many as in EasyList
+static const int GENERATED_RULES = 50000;
+
+// requests replayed, taken from fewer distinct ones: pages request the same urls again and again
+static const int CORPUS_REQUESTS = 300000;
+static const int DISTINCT_REQUESTS = 20000;
+
+
+// the non empty, non comment lines of a test data file
+static QStringList readDataLines(const QString &fileName)
+{
+    QStringList lines;
+
+    QFile file(QL1S(KDESRCDIR) + fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return lines;
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith(QL1C('#')))
+            continue;
+        lines << line;
+    }
+    return lines;
+}
+
+
+// a request, as QtWebKit would send it for the given resource type
+static QNetworkRequest networkRequest(const QString &type, const QString &pageUrl, const QString &url)
+{
+    QNetworkRequest request(QUrl(url));
+
+    if (pageUrl != QL1S("-"))
+        request.setRawHeader("Referer", pageUrl.toLatin1());
+
+    if (type == QL1S("document"))
+        request.setRawHeader("Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+    else if (type == QL1S("image"))
+        request.setRawHeader("Accept", "image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5");
+    else if (type == QL1S("stylesheet"))
+        request.setRawHeader("Accept", "text/css,*/*;q=0.1");
+    else
+        request.setRawHeader("Accept", "*/*");
+
+    if (type == QL1S("xmlhttprequest"))
+        request.setRawHeader("X-Requested-With", "XMLHttpRequest");
+
+    return request;
+}
+
+
+// Resident set size of the test process, in bytes (0 if unknown)
+static qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QL1S("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return 0;
+
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count() < 2)
+        return 0;
+
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+
+// A tiny LCG: the same list and corpus on every platform and run
+static quint32 s_seed = 20131017;
+
+static int randomNumber(int max)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return int((s_seed >> 8) % quint32(max));
+}
+
+
+// A rule, shaped as the EasyList ones: host, path and parameter filters,
+// some with options, exceptions and element hiding
+static QString generatedRule(int i)
+{
+    const QString n = QString::number(i);
+    switch (i % 20)
+    {
+    case 0: case 1: case 2: case 3: case 4: case 5:
+        return QL1S("||adhost") + n + QL1S(".adnet") + QString::number(i % 97) + QL1S(".com^");
+    case 6:
+        return QL1S("||tracker") + n + QL1S(".net^$third-party");
+    case 7: case 8: case 9:
+        return QL1S("/adpath") + n + QL1S("/");
+    case 10:
+        return QL1S("-banner") + n + QL1S(".");
+    case 11:
+        return QL1S("&adparam") + n + QL1S("=");
+    case 12:
+        return QL1S("/promo") + n + QL1S("/*.jpg$image,domain=site") + QString::number(i % 500) + QL1S(".com");
+    case 13:
+        return QL1S("@@||cdn") + n + QL1S(".example.org^$script");
+    case 14:
+        return QL1S("@@/adpath") + QString::number(i - 7) + QL1S("/allowed-");
+    case 15: case 16: case 17: case 18:
+        return QL1S("##.adclass") + n;
+    default:
+        return QL1S("site") + QString::number(i % 500) + QL1S(".com##.sponsor") + n;
+    }
+}
+
+
+// A request: mostly plain site resources, some ads and trackers
+static QNetworkRequest generatedRequest()
+{
+    static const char *const types[] = { "image", "script", "stylesheet", "xmlhttprequest", "object", "other" };
+
+    const QString site = QL1S("http://www.site") + QString::number(randomNumber(500)) + QL1S(".com/");
+    const int rule = randomNumber(GENERATED_RULES);
+    const QString n = QString::number(rule);
+
+    QString url;
+    switch (randomNumber(10))
+    {
+    case 0:
+        url = QL1S("http://adhost") + n + QL1S(".adnet") + QString::number(rule % 97) + QL1S(".com/slot.js");
+        break;
+    case 1:
+        url = site + QL1S("adpath") + n + QL1S("/banner.gif");
+        break;
+    case 2:
+        url = QL1S("http://tracker") + n + QL1S(".net/pixel.gif?page=") + n;
+        break;
+    default:
+        url = site + QL1S("static/") + QString::number(randomNumber(1000)) + QL1S("/resource") + n + QL1S(".png?v=2");
+        break;
+    }
+
+    return networkRequest(QL1S(types[randomNumber(6)]), site, url);
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+// Checks the decisions taken on a snapshot of EasyList against the expected ones.
+// Then benchmarks rules loading (parsing and from cache), the rule set memory
+// and matching, on a generated EasyList sized list and corpus.
+class AdBlockBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void decisions();
+
+    void loadRules();
+    void loadCachedRules();
+    void ruleSetMemory();
+    void matchCorpus();
+    void matchRequest();
+
+private:
+    KTempDir *m_tempDir;
+    QStringList m_rulesFiles;
+    QString m_cacheFilePath;
+
+    QVector<QNetworkRequest> m_requests;
+    QVector<int> m_corpus;
+
+    AdBlockRuleSetPtr m_ruleSet;
+};
+
+
+void AdBlockBenchmark::initTestCase()
+{
+    m_tempDir = new KTempDir;
+
+    m_rulesFiles << m_tempDir->name() + QL1S("generated_rules.txt");
+    m_cacheFilePath = m_tempDir->name() + QL1S("generated_rules.txt.cache");
+
+    QFile rulesFile(m_rulesFiles.first());
+    QVERIFY(rulesFile.open(QFile::WriteOnly | QFile::Text));
+
+    QTextStream out(&rulesFile);
+    out << "[Adblock Plus 2.0]\n! generated by the rekonq adblock benchmark\n";
+    for (int i = 0; i < GENERATED_RULES; ++i)
+        out << generatedRule(i) << '\n';
+    out.flush();
+    rulesFile.close();
+
+    m_requests.reserve(DISTINCT_REQUESTS);
+    for (int i = 0; i < DISTINCT_REQUESTS; ++i)
+        m_requests << generatedRequest();
+
+    // a few requests are way more frequent than the others, as in real browsing
+    m_corpus.reserve(CORPUS_REQUESTS);
+    for (int i = 0; i < CORPUS_REQUESTS; ++i)
+    {
+        const int request = randomNumber(DISTINCT_REQUESTS);
+        m_corpus << (randomNumber(2) ? request % (DISTINCT_REQUESTS / 20) : request);
+    }
+}
+
+
+void AdBlockBenchmark::cleanupTestCase()
+{
+    delete m_tempDir;
+}
+
+
+void AdBlockBenchmark::decisions()
+{
+    KTempDir cacheDir;
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(QStringList() << QL1S(KDESRCDIR) + QL1S("easylist_snapshot.txt"),
+                                                      cacheDir.name());
+
+    QList<QNetworkRequest> requests;
+    Q_FOREACH(const QString & line, readDataLines(QL1S("urls.txt")))
+    {
+        const QStringList fields = line.split(QL1C(' '));
+        QCOMPARE(fields.count(), 3);
+        requests << networkRequest(fields.at(0), fields.at(1), fields.at(2));
+    }
+
+    const QStringList expectedDecisions = readDataLines(QL1S("expected_decisions.txt"));
+    QCOMPARE(expectedDecisions.count(), requests.count());
+
+    for (int i = 0; i < requests.count(); ++i)
+    {
+        const QNetworkRequest &request = requests.at(i);
+        const bool blocked = ruleSet->blockRequest(AdBlockRequest(request));
+
+        const QString decision = (blocked ? QL1S("block ") : QL1S("allow ")) + request.url().toString();
+        QCOMPARE(decision, expectedDecisions.at(i));
+    }
+}
+
+
+void AdBlockBenchmark::loadRules()
+{
+    QFile::remove(m_cacheFilePath);
+
+    QBENCHMARK_ONCE
+    {
+        m_ruleSet = AdBlockRuleSet::build(m_rulesFiles, m_tempDir->name());
+    }
+
+    QVERIFY(m_ruleSet->blackRulesCount() > 0);
+    QVERIFY(m_ruleSet->whiteRulesCount() > 0);
+    QVERIFY(QFile::exists(m_cacheFilePath));
+}
+
+
+void AdBlockBenchmark::loadCachedRules()
+{
+    AdBlockRuleSetPtr cachedRuleSet;
+
+    QBENCHMARK
+    {
+        cachedRuleSet = AdBlockRuleSet::build(m_rulesFiles, m_tempDir->name());
+    }
+
+    QCOMPARE(cachedRuleSet->blackRulesCount(), m_ruleSet->blackRulesCount());
+    QCOMPARE(cachedRuleSet->whiteRulesCount(), m_ruleSet->whiteRulesCount());
+
+    // decisions have to be the same, whatever the way rules were loaded
+    for (int i = 0; i < m_requests.count(); i += 10)
+    {
+        const AdBlockRequest request(m_requests.at(i));
+        QCOMPARE(cachedRuleSet->blockRequest(request), m_ruleSet->blockRequest(request));
+    }
+}
+
+
+void AdBlockBenchmark::ruleSetMemory()
+{
+#ifndef Q_OS_LINUX
+    QSKIP("resident memory is known on Linux only", SkipAll);
+#endif
+
+    const qint64 initialMemory = residentMemory();
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(m_rulesFiles, m_tempDir->name());
+
+    // NOTE: QTest has no memory metric: the result, in KiB, is reported as events
+    QTest::setBenchmarkResult((residentMemory() - initialMemory) / 1024, QTest::Events);
+    QVERIFY(ruleSet->blackRulesCount() > 0);
+}
+
+
+void AdBlockBenchmark::matchCorpus()
+{
+    QBENCHMARK
+    {
+        Q_FOREACH(int request, m_corpus)
+        {
+            m_ruleSet->blockRequest(AdBlockRequest(m_requests.at(request)));
+        }
+    }
+}
+
+
+void AdBlockBenchmark::matchRequest()
+{
+    QElapsedTimer matchingTimer;
+    matchingTimer.start();
+
+    Q_FOREACH(int request, m_corpus)
+    {
+        m_ruleSet->blockRequest(AdBlockRequest(m_requests.at(request)));
+    }
+
+    // the corpus average, per request
+    QTest::setBenchmarkResult(matchingTimer.nsecsElapsed() / 1000000.0 / m_corpus.count(),
+                              QTest::WalltimeMilliseconds);
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(AdBlockBenchmark, NoGUI)
+#include "adblockbenchmark.moc"
@@ -0,0 +1,255 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockrequest.h"
+#include "adblockruleindex.h"
+#include "adblockruleset.h"
+
+// KDE Includes
+#include <KTempDir>
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QNetworkRequest>
+#include <QtTest>
+
+
+static bool blocks(const AdBlockRuleSetPtr &ruleSet, const QString &url)
+{
+    return ruleSet->blockRequest(AdBlockRequest(QNetworkRequest(QUrl(url))));
+}
+
+
+static void appendRules(const QString &rulesFilePath, const QByteArray &rules)
+{
+    QFile rulesFile(rulesFilePath);
+    QVERIFY(rulesFile.open(QFile::WriteOnly | QFile::Append));
+    rulesFile.write(rules);
+}
+
+
+// Checks the precompiled rules cache gives the same rules as the files,
+// and that outdated or broken caches are never used
+class AdBlockCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void buildWithoutCache();
+    void buildFromCache();
+    void outdatedCache();
+    void perListCache();
+    void truncatedCache();
+    void otherVersionCache();
+    void hugeCounts();
+
+private:
+    void checkDecisions(const AdBlockRuleSetPtr &ruleSet);
+
+    KTempDir *m_tempDir;
+    QString m_rulesFilePath;
+    QString m_cacheDirPath;
+    QString m_cacheFilePath;
+};
+
+
+void AdBlockCacheTest::init()
+{
+    m_tempDir = new KTempDir;
+    m_rulesFilePath = m_tempDir->name() + QL1S("adblockrules_1");
+    m_cacheDirPath = m_tempDir->name();
+    m_cacheFilePath = m_cacheDirPath + QL1S("adblockrules_1.cache");
+
+    appendRules(m_rulesFilePath,
+                "! test rules\n"
+                "||ads.example.net^\n"
+                "/adserver/\n"
+                "@@||example.com/adserver/allowed/\n"
+                "@@||trusted.example.org^\n"
+                "##.adsbox\n"
+                "example.com##.sponsor\n"
+                "##a</style><script>alert(1)</script>\n");
+}
+
+
+void AdBlockCacheTest::cleanup()
+{
+    delete m_tempDir;
+    m_tempDir = 0;
+}
+
+
+void AdBlockCacheTest::checkDecisions(const AdBlockRuleSetPtr &ruleSet)
+{
+    QVERIFY(blocks(ruleSet, QL1S("http://ads.example.net/slots.js")));
+    QVERIFY(blocks(ruleSet, QL1S("http://www.example.com/adserver/a.gif")));
+    QVERIFY(!blocks(ruleSet, QL1S("http://www.example.com/adserver/allowed/a.gif")));
+    QVERIFY(!blocks(ruleSet, QL1S("http://trusted.example.org/adserver/a.gif")));
+    QVERIFY(!blocks(ruleSet, QL1S("http://www.example.com/logo.png")));
+
+    QCOMPARE(ruleSet->blackRulesCount(), 1);
+    QCOMPARE(ruleSet->whiteRulesCount(), 1);
+}
+
+
+void AdBlockCacheTest::buildWithoutCache()
+{
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+
+    checkDecisions(ruleSet);
+    QVERIFY(QFile::exists(m_cacheFilePath));
+}
+
+
+void AdBlockCacheTest::buildFromCache()
+{
+    AdBlockRuleSetPtr parsedRuleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+    AdBlockRuleSetPtr cachedRuleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+
+    checkDecisions(cachedRuleSet);
+
+    const QString domain = QL1S("www.example.com");
+    QCOMPARE(cachedRuleSet->elementHiding().genericStyleSheet(),
+             parsedRuleSet->elementHiding().genericStyleSheet());
+    QVERIFY(cachedRuleSet->elementHiding().genericStyleSheet().contains(QL1S(".adsbox")));
+    QVERIFY(!cachedRuleSet->elementHiding().genericStyleSheet().contains(QL1C('<')));
+    QVERIFY(cachedRuleSet->elementHiding().domainStyleSheet(domain).contains(QL1S(".sponsor")));
+    QCOMPARE(cachedRuleSet->elementHiding().domainStyleSheet(domain),
+             parsedRuleSet->elementHiding().domainStyleSheet(domain));
+}
+
+
+void AdBlockCacheTest::outdatedCache()
+{
+    AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+
+    appendRules(m_rulesFilePath, "/banner.gif\n");
+
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+    QVERIFY(blocks(ruleSet, QL1S("http://www.example.com/banner.gif")));
+
+    // a rules file more or less makes the cache outdated, too
+    const QString otherRulesFilePath = m_tempDir->name() + QL1S("adblockrules_2");
+    appendRules(otherRulesFilePath, "/popup.js\n");
+
+    ruleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath << otherRulesFilePath, m_cacheDirPath);
+    QVERIFY(blocks(ruleSet, QL1S("http://www.example.com/popup.js")));
+
+    ruleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+    QVERIFY(!blocks(ruleSet, QL1S("http://www.example.com/popup.js")));
+}
+
+
+void AdBlockCacheTest::perListCache()
+{
+    const QString otherRulesFilePath = m_tempDir->name() + QL1S("adblockrules_2");
+    appendRules(otherRulesFilePath, "/popup.js\n");
+
+    const QStringList rulesFiles = QStringList() << m_rulesFilePath << otherRulesFilePath;
+    AdBlockRuleSet::build(rulesFiles, m_cacheDirPath);
+
+    QVERIFY(QFile::exists(m_cacheFilePath));
+    QVERIFY(QFile::exists(m_cacheDirPath + QL1S("adblockrules_2.cache")));
+
+    // just the changed list is outdated: the other one comes from its cache
+    appendRules(otherRulesFilePath, "/banner.gif\n");
+
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(rulesFiles, m_cacheDirPath);
+    QVERIFY(blocks(ruleSet, QL1S("http://ads.example.net/slots.js")));
+    QVERIFY(!blocks(ruleSet, QL1S("http://www.example.com/adserver/allowed/a.gif")));
+    QVERIFY(blocks(ruleSet, QL1S("http://www.example.com/popup.js")));
+    QVERIFY(blocks(ruleSet, QL1S("http://www.example.com/banner.gif")));
+}
+
+
+void AdBlockCacheTest::truncatedCache()
+{
+    AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+
+    QFile cacheFile(m_cacheFilePath);
+    const qint64 cacheSize = cacheFile.size();
+    QVERIFY(cacheFile.resize(cacheSize / 2));
+
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+    checkDecisions(ruleSet);
+
+    // and a good one has been saved again
+    QCOMPARE(QFile(m_cacheFilePath).size(), cacheSize);
+}
+
+
+void AdBlockCacheTest::otherVersionCache()
+{
+    QFile cacheFile(m_cacheFilePath);
+    QVERIFY(cacheFile.open(QFile::WriteOnly));
+
+    QDataStream out(&cacheFile);
+    out << quint32(0x524b4142) << quint32(0);
+    cacheFile.close();
+
+    AdBlockRuleSetPtr ruleSet = AdBlockRuleSet::build(QStringList() << m_rulesFilePath, m_cacheDirPath);
+    checkDecisions(ruleSet);
+}
+
+
+void AdBlockCacheTest::hugeCounts()
+{
+    // counts read from a broken cache must not be trusted to allocate memory
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << qint32(1) << quint32(0x7fffffff);
+
+    AdBlockRuleIndex index;
+    QDataStream in(data);
+    index.load(in);
+    QVERIFY(in.status() != QDataStream::Ok);
+
+    // the same, for a rule list
+    data.clear();
+    QDataStream listOut(&data, QIODevice::WriteOnly);
+    listOut << qint32(1) << quint32(0) << quint32(0x7fffffff);
+
+    QDataStream listIn(data);
+    index.load(listIn);
+    QVERIFY(listIn.status() != QDataStream::Ok);
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(AdBlockCacheTest, NoGUI)
+#include "adblockcachetest.moc"
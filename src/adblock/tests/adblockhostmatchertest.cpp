@@ -0,0 +1,157 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockhostmatcher.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QByteArray>
+#include <QDataStream>
+#include <QtTest>
+
+
+class AdBlockHostMatcherTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void tryAddFilter_data();
+    void tryAddFilter();
+
+    void match_data();
+    void match();
+
+    void saveLoad();
+};
+
+
+void AdBlockHostMatcherTest::tryAddFilter_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<bool>("result");
+
+    QTest::newRow("domain") << "||example.com^" << true;
+    QTest::newRow("domain, slash") << "||example.com/" << true;
+    QTest::newRow("white domain") << "@@||example.com^" << true;
+    QTest::newRow("white host") << "@@ads.example.com" << true;
+    QTest::newRow("white host, slash") << "@@ads.example.com/" << true;
+
+    QTest::newRow("domain, path") << "||example.com/ads/" << false;
+    QTest::newRow("domain, no separator") << "||example.com" << false;
+    QTest::newRow("domain, wildcard") << "||ads.*.com^" << false;
+    QTest::newRow("domain, options") << "||example.com^$third-party" << false;
+    QTest::newRow("white domain, options") << "@@||example.com^$script" << false;
+    QTest::newRow("white host, path") << "@@ads.example.com/banner" << false;
+    QTest::newRow("white host, wildcard") << "@@*.example.com" << false;
+    QTest::newRow("white host, anchor") << "@@|http://example.com" << false;
+    QTest::newRow("white path") << "@@/ads/allowed/" << false;
+    QTest::newRow("white text") << "@@-advert-" << false;
+    QTest::newRow("plain") << "example.com" << false;
+    QTest::newRow("path") << "/adserver/" << false;
+}
+
+
+void AdBlockHostMatcherTest::tryAddFilter()
+{
+    QFETCH(QString, filter);
+    QFETCH(bool, result);
+
+    AdBlockHostMatcher matcher;
+    QCOMPARE(matcher.tryAddFilter(filter), result);
+}
+
+
+void AdBlockHostMatcherTest::match_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<bool>("result");
+
+    // ||domain^ rules match the domain and all its subdomains
+    QTest::newRow("domain") << "||example.com^" << "example.com" << true;
+    QTest::newRow("subdomain") << "||example.com^" << "www.example.com" << true;
+    QTest::newRow("subsubdomain") << "||example.com^" << "a.b.example.com" << true;
+    QTest::newRow("suffix") << "||example.com^" << "notexample.com" << false;
+    QTest::newRow("prefix") << "||example.com^" << "example.com.example.org" << false;
+    QTest::newRow("tld") << "||example.com^" << "com" << false;
+    QTest::newRow("parent") << "||ads.example.com^" << "example.com" << false;
+
+    // @@host rules match just that host
+    QTest::newRow("host") << "@@ads.example.com" << "ads.example.com" << true;
+    QTest::newRow("host, subdomain") << "@@ads.example.com" << "www.ads.example.com" << false;
+    QTest::newRow("host, parent") << "@@ads.example.com" << "example.com" << false;
+
+    QTest::newRow("uppercase filter") << "||Example.COM^" << "www.example.com" << true;
+    QTest::newRow("uppercase host") << "||example.com^" << "WWW.Example.com" << true;
+}
+
+
+void AdBlockHostMatcherTest::match()
+{
+    QFETCH(QString, filter);
+    QFETCH(QString, host);
+    QFETCH(bool, result);
+
+    AdBlockHostMatcher matcher;
+    QVERIFY(matcher.tryAddFilter(filter));
+    QCOMPARE(matcher.match(host), result);
+}
+
+
+void AdBlockHostMatcherTest::saveLoad()
+{
+    AdBlockHostMatcher matcher;
+    QVERIFY(matcher.tryAddFilter(QL1S("||example.com^")));
+    QVERIFY(matcher.tryAddFilter(QL1S("@@ads.example.org")));
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    matcher.save(out);
+
+    AdBlockHostMatcher loadedMatcher;
+    QDataStream in(data);
+    loadedMatcher.load(in);
+
+    QVERIFY(loadedMatcher.match(QL1S("www.example.com")));
+    QVERIFY(loadedMatcher.match(QL1S("ads.example.org")));
+    QVERIFY(!loadedMatcher.match(QL1S("www.example.org")));
+
+    loadedMatcher.clear();
+    QVERIFY(!loadedMatcher.match(QL1S("www.example.com")));
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(AdBlockHostMatcherTest, NoGUI)
+#include "adblockhostmatchertest.moc"
@@ -0,0 +1,237 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockrequest.h"
+#include "adblockrule.h"
+#include "adblockruleset.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QNetworkRequest>
+#include <QtTest>
+
+
+Q_DECLARE_METATYPE(AdBlockRequest::ContentType)
+
+
+// a request like QtWebKit sends them: accept is the Accept header, "xhr" for XMLHttpRequests
+static QNetworkRequest networkRequest(const QString &url, const QByteArray &accept, const QString &pageUrl = QString())
+{
+    QNetworkRequest request((QUrl(url)));
+
+    if (accept == "xhr")
+    {
+        request.setRawHeader("Accept", "*/*");
+        request.setRawHeader("X-Requested-With", "XMLHttpRequest");
+    }
+    else
+    {
+        request.setRawHeader("Accept", accept);
+    }
+
+    if (!pageUrl.isEmpty())
+        request.setRawHeader("Referer", pageUrl.toLatin1());
+
+    return request;
+}
+
+
+class AdBlockOptionsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void contentType_data();
+    void contentType();
+
+    void options_data();
+    void options();
+
+    void pageWhiteList_data();
+    void pageWhiteList();
+};
+
+
+void AdBlockOptionsTest::contentType_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QByteArray>("accept");
+    QTest::addColumn<AdBlockRequest::ContentType>("type");
+
+    QTest::newRow("page") << "http://www.example.com/" << QByteArray("text/html,application/xhtml+xml,*/*;q=0.8")
+                          << AdBlockRequest::DocumentContent;
+    QTest::newRow("xhr") << "http://www.example.com/data" << QByteArray("xhr")
+                         << AdBlockRequest::XmlHttpRequestContent;
+    QTest::newRow("stylesheet") << "http://www.example.com/style" << QByteArray("text/css,*/*;q=0.1")
+                                << AdBlockRequest::StyleSheetContent;
+    QTest::newRow("image") << "http://www.example.com/logo" << QByteArray("image/png,image/*;q=0.8")
+                           << AdBlockRequest::ImageContent;
+    QTest::newRow("video") << "http://www.example.com/clip" << QByteArray("video/webm,video/*;q=0.9")
+                           << AdBlockRequest::MediaContent;
+    QTest::newRow("script") << "http://www.example.com/jquery.js" << QByteArray("*/*")
+                            << AdBlockRequest::ScriptContent;
+    QTest::newRow("object") << "http://www.example.com/intro.swf" << QByteArray("*/*")
+                            << AdBlockRequest::ObjectContent;
+    QTest::newRow("media") << "http://www.example.com/clip.MP4" << QByteArray("*/*")
+                           << AdBlockRequest::MediaContent;
+    QTest::newRow("font") << "http://www.example.com/fonts/sans.woff" << QByteArray("*/*")
+                          << AdBlockRequest::FontContent;
+    QTest::newRow("websocket") << "ws://www.example.com/socket" << QByteArray("*/*")
+                               << AdBlockRequest::WebSocketContent;
+    QTest::newRow("other") << "http://www.example.com/counter.php" << QByteArray("*/*")
+                           << AdBlockRequest::OtherContent;
+}
+
+
+void AdBlockOptionsTest::contentType()
+{
+    QFETCH(QString, url);
+    QFETCH(QByteArray, accept);
+    QFETCH(AdBlockRequest::ContentType, type);
+
+    const AdBlockRequest request(networkRequest(url, accept));
+    QCOMPARE(request.contentType(), type);
+
+    // scripts asking for html pages are still scripts
+    if (accept == "xhr")
+    {
+        QNetworkRequest htmlRequest = networkRequest(url, accept);
+        htmlRequest.setRawHeader("Accept", "text/html, */*; q=0.01");
+        QCOMPARE(AdBlockRequest(htmlRequest).contentType(), AdBlockRequest::XmlHttpRequestContent);
+    }
+}
+
+
+void AdBlockOptionsTest::options_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QByteArray>("accept");
+    QTest::addColumn<QString>("pageUrl");
+    QTest::addColumn<bool>("result");
+
+    const QString page = QL1S("http://www.example.com/");
+
+    // types
+    QTest::newRow("no type, script") << "/ads/*" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << true;
+    QTest::newRow("no type, page") << "/ads/*" << "http://www.example.com/ads/a.html" << QByteArray("text/html") << page << false;
+    QTest::newRow("script") << "/ads/*$script" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << true;
+    QTest::newRow("script, image") << "/ads/*$script" << "http://www.example.com/ads/a.png" << QByteArray("image/png") << page << false;
+    QTest::newRow("~image") << "/ads/*$~image" << "http://www.example.com/ads/a.png" << QByteArray("image/png") << page << false;
+    QTest::newRow("~image, script") << "/ads/*$~image" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << true;
+    QTest::newRow("xhr") << "/ads/*$xmlhttprequest" << "http://www.example.com/ads/a" << QByteArray("xhr") << page << true;
+    QTest::newRow("media") << "/ads/*$media" << "http://www.example.com/ads/a.mp4" << QByteArray("*/*") << page << true;
+    QTest::newRow("font") << "/ads/*$font" << "http://www.example.com/ads/a.woff" << QByteArray("*/*") << page << true;
+    QTest::newRow("font, script") << "/ads/*$font" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << false;
+    QTest::newRow("websocket") << "/ads/*$websocket" << "ws://www.example.com/ads/a" << QByteArray("*/*") << page << true;
+    QTest::newRow("popup") << "/ads/*$popup" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << false;
+    QTest::newRow("script and popup") << "/ads/*$script,popup" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << true;
+
+    // third party
+    QTest::newRow("third-party") << "/ads/*$third-party" << "http://ads.example.net/ads/a.js" << QByteArray("*/*") << page << true;
+    QTest::newRow("third-party, same site") << "/ads/*$third-party" << "http://static.example.com/ads/a.js" << QByteArray("*/*") << page << false;
+    QTest::newRow("~third-party") << "/ads/*$~third-party" << "http://static.example.com/ads/a.js" << QByteArray("*/*") << page << true;
+
+    // domains
+    QTest::newRow("domain") << "/ads/*$domain=example.com" << "http://ads.example.net/ads/a.js" << QByteArray("*/*") << page << true;
+    QTest::newRow("domain, other") << "/ads/*$domain=example.org" << "http://ads.example.net/ads/a.js" << QByteArray("*/*") << page << false;
+    QTest::newRow("~domain") << "/ads/*$domain=~example.com" << "http://ads.example.net/ads/a.js" << QByteArray("*/*") << page << false;
+    QTest::newRow("domain, subdomain excluded") << "/ads/*$domain=example.com|~www.example.com" << "http://ads.example.net/ads/a.js"
+                                                << QByteArray("*/*") << page << false;
+
+    // case
+    QTest::newRow("case") << "/Ads/*" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << true;
+    QTest::newRow("match-case") << "/Ads/*$match-case" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << false;
+
+    // rules that do not block requests
+    QTest::newRow("csp") << "/ads/*$csp=script-src 'self'" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << false;
+    QTest::newRow("unknown option") << "/ads/*$nonsense" << "http://www.example.com/ads/a.js" << QByteArray("*/*") << page << false;
+}
+
+
+void AdBlockOptionsTest::options()
+{
+    QFETCH(QString, filter);
+    QFETCH(QString, url);
+    QFETCH(QByteArray, accept);
+    QFETCH(QString, pageUrl);
+    QFETCH(bool, result);
+
+    const AdBlockRule rule(filter);
+    QCOMPARE(rule.match(AdBlockRequest(networkRequest(url, accept, pageUrl))), result);
+}
+
+
+void AdBlockOptionsTest::pageWhiteList_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<QString>("pageUrl");
+    QTest::addColumn<bool>("blocked");
+
+    QTest::newRow("no exception") << "" << "http://www.example.com/" << true;
+    QTest::newRow("document") << "@@||example.com^$document" << "http://www.example.com/news/" << false;
+    QTest::newRow("document, other page") << "@@||example.com^$document" << "http://www.example.org/" << true;
+    QTest::newRow("document and elemhide") << "@@||example.com^$document,elemhide" << "http://www.example.com/" << false;
+    QTest::newRow("document, path") << "@@||example.com/forum/$document" << "http://www.example.com/forum/1" << false;
+    QTest::newRow("document, other path") << "@@||example.com/forum/$document" << "http://www.example.com/news/" << true;
+
+    // not page exceptions
+    QTest::newRow("elemhide") << "@@||example.com^$elemhide" << "http://www.example.com/" << true;
+    QTest::newRow("script") << "@@||example.com^$script" << "http://www.example.com/" << true;
+}
+
+
+void AdBlockOptionsTest::pageWhiteList()
+{
+    QFETCH(QString, rule);
+    QFETCH(QString, pageUrl);
+    QFETCH(bool, blocked);
+
+    AdBlockRuleSet ruleSet;
+    ruleSet.loadRuleString(QL1S("||ads.example.net^"));
+    ruleSet.loadRuleString(QL1S("/banner/*"));
+    ruleSet.loadRuleString(rule);
+
+    // what the page loads...
+    QCOMPARE(ruleSet.blockRequest(AdBlockRequest(networkRequest(QL1S("http://ads.example.net/a.js"), "*/*", pageUrl))), blocked);
+    QCOMPARE(ruleSet.blockRequest(AdBlockRequest(networkRequest(QL1S("http://www.example.com/banner/a.png"), "image/png", pageUrl))), blocked);
+
+    // ...and the page itself
+    QCOMPARE(ruleSet.isPageWhiteListed(QUrl(pageUrl)), !blocked);
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(AdBlockOptionsTest, NoGUI)
+#include "adblockoptionstest.moc"
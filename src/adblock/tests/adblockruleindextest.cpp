@@ -0,0 +1,167 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "adblockrequest.h"
+#include "adblockruleindex.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QByteArray>
+#include <QDataStream>
+#include <QNetworkRequest>
+#include <QtTest>
+
+
+class AdBlockRuleIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void match_data();
+    void match();
+
+    void count();
+    void saveLoad();
+};
+
+
+void AdBlockRuleIndexTest::match_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<bool>("result");
+
+    // indexed rules
+    QTest::newRow("path") << "/adserver/" << "http://www.example.com/adserver/a.gif" << true;
+    QTest::newRow("path, longer token") << "/adserver/" << "http://www.example.com/adservers/a.gif" << false;
+    QTest::newRow("separators") << "-ad-banner." << "http://www.example.com/top-ad-banner.gif" << true;
+    QTest::newRow("uppercase url") << "/adserver/" << "http://www.example.com/AdServer/a.gif" << true;
+    QTest::newRow("query") << "&ad_type=" << "http://www.example.com/search?q=ad&ad_type=text" << true;
+    QTest::newRow("wildcards") << "/ads/*/banner*.gif" << "http://www.example.com/ads/summer/banner_1.gif" << true;
+    QTest::newRow("wildcards, no match") << "/ads/*/banner*.gif" << "http://www.example.com/ads/summer/button.gif" << false;
+    QTest::newRow("anchor") << "|http://ad.*/banner/" << "http://ad.example.com/banner/1.png" << true;
+    QTest::newRow("anchor, no match") << "|http://ad.*/banner/" << "http://www.example.com/ad.example/banner/1.png" << false;
+    QTest::newRow("domain anchor") << "||ads.example.net^$script" << "http://ads.example.net/slots.js" << true;
+    QTest::newRow("domain anchor, subdomain") << "||example.net^$script" << "http://ads.example.net/slots.js" << true;
+
+    // rules with no token delimited on both sides: they are not indexed, but still checked
+    QTest::newRow("no token") << "banner" << "http://www.example.com/mybanners.gif" << true;
+    QTest::newRow("wildcard token") << "*adv*" << "http://www.example.com/advert.gif" << true;
+    QTest::newRow("no token, no match") << "banner" << "http://www.example.com/button.gif" << false;
+}
+
+
+void AdBlockRuleIndexTest::match()
+{
+    QFETCH(QString, filter);
+    QFETCH(QString, url);
+    QFETCH(bool, result);
+
+    AdBlockRuleIndex index;
+
+    // some noise, sharing tokens with the tested rule
+    index.addRule(QL1S("/adserver/banner/"));
+    index.addRule(QL1S("/ads/popup."));
+    index.addRule(QL1S("-ad-sidebar."));
+
+    index.addRule(filter);
+
+    const AdBlockRequest request((QNetworkRequest(QUrl(url))));
+    QCOMPARE(index.match(request), result);
+}
+
+
+void AdBlockRuleIndexTest::count()
+{
+    AdBlockRuleIndex index;
+    QCOMPARE(index.count(), 0);
+
+    index.addRule(QL1S("/adserver/"));
+    index.addRule(QL1S("banner"));
+    QCOMPARE(index.count(), 2);
+
+    // popup rules never match a request: they are not stored at all
+    index.addRule(QL1S("||popads.net^$popup"));
+    QCOMPARE(index.count(), 2);
+
+    index.clear();
+    QCOMPARE(index.count(), 0);
+    QVERIFY(!index.match(AdBlockRequest(QNetworkRequest(QUrl(QL1S("http://www.example.com/adserver/"))))));
+}
+
+
+void AdBlockRuleIndexTest::saveLoad()
+{
+    const QStringList filters = QStringList()
+                                << QL1S("/adserver/")
+                                << QL1S("banner")
+                                << QL1S("||ads.example.net^$script")
+                                << QL1S("/ads/*/banner*.gif");
+
+    AdBlockRuleIndex index;
+    Q_FOREACH(const QString & filter, filters)
+    {
+        index.addRule(filter);
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    index.save(out);
+
+    AdBlockRuleIndex loadedIndex;
+    QDataStream in(data);
+    loadedIndex.load(in);
+
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QCOMPARE(loadedIndex.count(), index.count());
+
+    const QStringList urls = QStringList()
+                             << QL1S("http://www.example.com/adserver/a.gif")
+                             << QL1S("http://www.example.com/mybanners.gif")
+                             << QL1S("http://ads.example.net/slots.js")
+                             << QL1S("http://ads.example.net/slots.png")
+                             << QL1S("http://www.example.com/ads/summer/banner_1.gif")
+                             << QL1S("http://www.example.com/button.gif");
+
+    Q_FOREACH(const QString & url, urls)
+    {
+        const AdBlockRequest request((QNetworkRequest(QUrl(url))));
+        QCOMPARE(loadedIndex.match(request), index.match(request));
+    }
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(AdBlockRuleIndexTest, NoGUI)
+#include "adblockruleindextest.moc"
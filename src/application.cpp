@@ -52,6 +52,7 @@
 #include "historymanager.h"
 #include "iconmanager.h"
 #include "sessionmanager.h"
+#include "thumbnailstore.h"
 
 // Ui Includes
 #include "ui_cleardata.h"
@@ -93,7 +94,7 @@ Application::Application()
 
     setWindowIcon(KIcon("rekonq"));
 
-    // just create History Manager...
+    // just create History Manager: it loads history in a worker thread
     HistoryManager::self();
 }
 
@@ -528,7 +529,8 @@ bool Application::eventFilter(QObject* watched, QEvent* event)
 
         if (window)
         {
-            SessionManager::self()->saveSession();
+            // save it now: the window is still in the list
+            SessionManager::self()->saveSessionNow();
             m_rekonqWindows.removeOne(window);
 #ifdef HAVE_KACTIVITIES
             QString currentActivity = m_activityConsumer->currentActivity();
@@ -699,7 +701,7 @@ void Application::updateConfiguration()
     case 2: // url previews
         for (int i = 0; i < rekonqWindow()->tabBar()->count(); i++)
         {
-            rekonqWindow()->tabBar()->setTabToolTip(i, rekonqWindow()->tabWidget()->webWindow(i)->url().toMimeDataString());
+            rekonqWindow()->tabBar()->setTabToolTip(i, rekonqWindow()->tabWidget()->urlAt(i).toMimeDataString());
         }
         break;
 
@@ -811,15 +813,7 @@ void Application::clearPrivateData()
 
         if (clearWidget.homePageThumbs->isChecked())
         {
-            QString path = KStandardDirs::locateLocal("cache", QString("thumbs/rekonq"), true);
-            path.remove("rekonq");
-            QDir cacheDir(path);
-            QStringList fileList = cacheDir.entryList();
-            Q_FOREACH(const QString & str, fileList)
-            {
-                QFile file(path + str);
-                file.remove();
-            }
+            ThumbnailStore::self()->clearThumbnails();
         }
     }
 
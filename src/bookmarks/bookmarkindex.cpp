@@ -0,0 +1,345 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Self Includes
+#include "bookmarkindex.h"
+
+// KDE Includes
+#include <KBookmarkManager>
+#include <KUrl>
+
+// generic algorithms
+#include <QtAlgorithms>
+
+
+// NOTE
+// Induce the document order in the bookmark addresses ("/2/10" comes after "/2/9")
+static bool addressLessThan(const QString &a, const QString &b)
+{
+    const QStringList aList = a.split(QL1C('/'), QString::SkipEmptyParts);
+    const QStringList bList = b.split(QL1C('/'), QString::SkipEmptyParts);
+
+    for (int i = 0; i < aList.count() && i < bList.count(); ++i)
+    {
+        const int x = aList.at(i).toInt();
+        const int y = bList.at(i).toInt();
+        if (x != y)
+            return x < y;
+    }
+    return aList.count() < bList.count();
+}
+
+
+// Split text in (lower case) words: runs of letters and digits
+static QStringList splitWords(const QString &text)
+{
+    QStringList words;
+
+    const QString lower = text.toLower();
+    int start = -1;
+    for (int i = 0; i <= lower.length(); ++i)
+    {
+        const bool isWordChar = (i < lower.length()) && lower.at(i).isLetterOrNumber();
+        if (isWordChar && start == -1)
+        {
+            start = i;
+        }
+        else if (!isWordChar && start != -1)
+        {
+            words << lower.mid(start, i - start);
+            start = -1;
+        }
+    }
+
+    return words;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+
+
+BookmarkIndex::BookmarkIndex(KBookmarkManager *manager)
+    : m_manager(manager)
+    , m_suffixesNeedBuild(false)
+{
+}
+
+
+QString BookmarkIndex::urlKey(const KUrl &url)
+{
+    return url.url(KUrl::RemoveTrailingSlash);
+}
+
+
+void BookmarkIndex::rebuild()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_entries.clear();
+    m_urls.clear();
+    m_words.clear();
+    m_suffixes.clear();
+    m_suffixesNeedBuild = false;
+
+    addGroup(m_manager->root());
+}
+
+
+void BookmarkIndex::updateGroup(const QString &groupAddress)
+{
+    KBookmark group = m_manager->findByAddress(groupAddress);
+    if (groupAddress.isEmpty() || group.isNull() || !group.isGroup())
+    {
+        rebuild();
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // bookmarks addresses in a changed group are no more valid.
+    // They all start with the group one: in the (ordered) entries, they come one after the other
+    const QString prefix = groupAddress + QL1C('/');
+    QStringList removed;
+    QMap<QString, Entry>::const_iterator it = m_entries.lowerBound(prefix);
+    for (; it != m_entries.constEnd() && it.key().startsWith(prefix); ++it)
+    {
+        removed << it.key();
+    }
+
+    Q_FOREACH(const QString & address, removed)
+    {
+        removeBookmark(address);
+    }
+
+    addGroup(group.toGroup());
+}
+
+
+void BookmarkIndex::addGroup(const KBookmarkGroup &group)
+{
+    if (group.isNull())
+        return;
+
+    for (KBookmark bookmark = group.first(); !bookmark.isNull(); bookmark = group.next(bookmark))
+    {
+        if (bookmark.isGroup())
+            addGroup(bookmark.toGroup());
+        else if (!bookmark.isSeparator())
+            addBookmark(bookmark);
+    }
+}
+
+
+void BookmarkIndex::addBookmark(const KBookmark &bookmark)
+{
+    const QString address = bookmark.address();
+
+    Entry entry;
+    entry.url = bookmark.url().url();
+    entry.text = bookmark.fullText();
+    entry.words = splitWords(entry.url) + splitWords(entry.text);
+    entry.words.removeDuplicates();
+
+    m_urls[urlKey(bookmark.url())].insert(address);
+    Q_FOREACH(const QString & word, entry.words)
+    {
+        QSet<QString> &addresses = m_words[word];
+        if (addresses.isEmpty())
+            m_suffixesNeedBuild = true;
+        addresses.insert(address);
+    }
+
+    m_entries.insert(address, entry);
+}
+
+
+void BookmarkIndex::removeBookmark(const QString &address)
+{
+    const Entry entry = m_entries.take(address);
+
+    const QString key = urlKey(KUrl(entry.url));
+    m_urls[key].remove(address);
+    if (m_urls[key].isEmpty())
+        m_urls.remove(key);
+
+    Q_FOREACH(const QString & word, entry.words)
+    {
+        m_words[word].remove(address);
+        if (m_words[word].isEmpty())
+        {
+            m_words.remove(word);
+            m_suffixesNeedBuild = true;
+        }
+    }
+}
+
+
+bool BookmarkIndex::suffixLessThan(const WordSuffix &a, const WordSuffix &b)
+{
+    return a.word.midRef(a.position) < b.word.midRef(b.position);
+}
+
+
+void BookmarkIndex::buildSuffixes() const
+{
+    m_suffixes.clear();
+
+    QHash<QString, QSet<QString> >::const_iterator it;
+    for (it = m_words.constBegin(); it != m_words.constEnd(); ++it)
+    {
+        WordSuffix suffix;
+        suffix.word = it.key();
+        for (suffix.position = 0; suffix.position < suffix.word.length(); ++suffix.position)
+            m_suffixes.append(suffix);
+    }
+
+    qSort(m_suffixes.begin(), m_suffixes.end(), suffixLessThan);
+    m_suffixesNeedBuild = false;
+}
+
+
+QSet<QString> BookmarkIndex::wordsContaining(const QString &piece) const
+{
+    if (m_suffixesNeedBuild)
+        buildSuffixes();
+
+    // the words containing piece have a suffix starting with it: all of them
+    // come one after the other, from where piece would be in the sorted suffixes
+    WordSuffix probe;
+    probe.word = piece;
+    probe.position = 0;
+
+    QSet<QString> words;
+    QVector<WordSuffix>::const_iterator it = qLowerBound(m_suffixes.constBegin(), m_suffixes.constEnd(),
+                                                         probe, suffixLessThan);
+    for (; it != m_suffixes.constEnd() && it->word.midRef(it->position).startsWith(piece); ++it)
+    {
+        words.insert(it->word);
+    }
+
+    return words;
+}
+
+
+QStringList BookmarkIndex::sortedByAddress(const QSet<QString> &addresses) const
+{
+    QStringList list = addresses.toList();
+    qSort(list.begin(), list.end(), addressLessThan);
+    return list;
+}
+
+
+KBookmark BookmarkIndex::bookmarkForUrl(const KUrl &url) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QHash<QString, QSet<QString> >::const_iterator it = m_urls.constFind(urlKey(url));
+    if (it == m_urls.constEnd())
+        return KBookmark();
+
+    // the first one, as in the bookmarks tree
+    const QString address = (it.value().count() == 1)
+                            ? *it.value().constBegin()
+                            : sortedByAddress(it.value()).first();
+
+    locker.unlock();
+    return m_manager->findByAddress(address);
+}
+
+
+QList<KBookmark> BookmarkIndex::find(const QString &text) const
+{
+    QList<KBookmark> list;
+    Q_FOREACH(const BookmarkMatch & found, match(text))
+    {
+        list << m_manager->findByAddress(found.address);
+    }
+    return list;
+}
+
+
+QList<BookmarkMatch> BookmarkIndex::match(const QString &text) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QList<BookmarkMatch> list;
+
+    const QStringList queryWords = text.split(QL1C(' '), QString::SkipEmptyParts);
+
+    // NOTE
+    // every word of the query has to be found in the url or in the title
+    // of a bookmark. Each piece of it (letters and digits runs) is then
+    // part of one of the bookmark words: look for them in the words index.
+    QSet<QString> candidates;
+    bool allBookmarks = true;
+    Q_FOREACH(const QString & piece, splitWords(queryWords.join(QL1S(" "))))
+    {
+        QSet<QString> matching;
+        Q_FOREACH(const QString & word, wordsContaining(piece))
+        {
+            matching.unite(m_words.value(word));
+        }
+
+        if (allBookmarks)
+            candidates = matching;
+        else
+            candidates.intersect(matching);
+        allBookmarks = false;
+
+        if (candidates.isEmpty())
+            return list;
+    }
+
+    if (allBookmarks)
+        candidates = m_entries.keys().toSet();
+
+    Q_FOREACH(const QString & address, sortedByAddress(candidates))
+    {
+        const Entry entry = m_entries.value(address);
+
+        bool matches = true;
+        Q_FOREACH(const QString & word, queryWords)
+        {
+            if (!entry.url.contains(word, Qt::CaseInsensitive)
+                    && !entry.text.contains(word, Qt::CaseInsensitive))
+            {
+                matches = false;
+                break;
+            }
+        }
+
+        if (matches)
+        {
+            BookmarkMatch found;
+            found.address = address;
+            found.url = entry.url;
+            found.text = entry.text;
+            list << found;
+        }
+    }
+
+    return list;
+}
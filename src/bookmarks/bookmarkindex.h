@@ -0,0 +1,134 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+#ifndef BOOKMARK_INDEX_H
+#define BOOKMARK_INDEX_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// KDE Includes
+#include <KBookmark>
+
+// Qt Includes
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Forward Declarations
+class KBookmarkManager;
+class KUrl;
+
+
+/**
+ * A bookmark found searching some text, detached from the bookmarks tree
+ *
+ */
+struct BookmarkMatch
+{
+    QString address;
+    QString url;
+    QString text;
+};
+
+
+/**
+ * Flat index of the bookmarks, to avoid walking the whole bookmarks
+ * tree when looking for an url or searching some text.
+ *
+ * Bookmarks are stored by address, in address order: when a group changes,
+ * just the bookmarks in it (a range of addresses) are indexed again.
+ * Text is searched in the sorted suffixes of the bookmark words, so that
+ * every piece of the query is looked up, not scanned for.
+ *
+ * match() doesn't touch the bookmarks tree and can be used
+ * from a worker thread.
+ *
+ */
+class REKONQ_TESTS_EXPORT BookmarkIndex
+{
+public:
+    explicit BookmarkIndex(KBookmarkManager *manager);
+
+    void rebuild();
+    void updateGroup(const QString &groupAddress);
+
+    KBookmark bookmarkForUrl(const KUrl &url) const;
+    QList<KBookmark> find(const QString &text) const;
+    QList<BookmarkMatch> match(const QString &text) const;
+
+    static QString urlKey(const KUrl &url);
+
+private:
+    struct Entry
+    {
+        QString url;
+        QString text;
+        QStringList words;
+    };
+
+    // a word, from position on
+    struct WordSuffix
+    {
+        QString word;
+        int position;
+    };
+
+    static bool suffixLessThan(const WordSuffix &a, const WordSuffix &b);
+    void buildSuffixes() const;
+    QSet<QString> wordsContaining(const QString &piece) const;
+
+    void addGroup(const KBookmarkGroup &group);
+    void addBookmark(const KBookmark &bookmark);
+    void removeBookmark(const QString &address);
+
+    QStringList sortedByAddress(const QSet<QString> &addresses) const;
+
+    KBookmarkManager *m_manager;
+
+    mutable QMutex m_mutex;
+
+    // address -> entry. Ordered: the bookmarks of a group are one after the other
+    QMap<QString, Entry> m_entries;
+
+    // url -> addresses
+    QHash<QString, QSet<QString> > m_urls;
+
+    // title & url word -> addresses
+    QHash<QString, QSet<QString> > m_words;
+
+    // all the suffixes of the words, sorted. Built again when words change
+    mutable QVector<WordSuffix> m_suffixes;
+    mutable bool m_suffixesNeedBuild;
+};
+
+
+#endif // BOOKMARK_INDEX_H
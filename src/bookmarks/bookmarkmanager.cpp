@@ -34,6 +34,7 @@
 // Local Includes
 #include "application.h"
 
+#include "bookmarkindex.h"
 #include "bookmarksmenu.h"
 #include "bookmarkstoolbar.h"
 #include "bookmarkowner.h"
@@ -72,6 +73,7 @@ BookmarkManager::BookmarkManager(QObject *parent)
     , m_manager(0)
     , m_owner(0)
     , m_actionCollection(new KActionCollection(this))
+    , m_index(0)
 {
     m_manager = KBookmarkManager::userBookmarksManager();
     const QString bookmarksFile = KStandardDirs::locateLocal("data", QString::fromLatin1("konqueror/bookmarks.xml"));
@@ -88,7 +90,10 @@ BookmarkManager::BookmarkManager(QObject *parent)
         delete tempManager;
     }
 
-    connect(m_manager, SIGNAL(changed(QString,QString)), this, SLOT(slotBookmarksChanged()));
+    m_index = new BookmarkIndex(m_manager);
+    m_index->rebuild();
+
+    connect(m_manager, SIGNAL(changed(QString,QString)), this, SLOT(slotBookmarksChanged(QString)));
 
     // setup menu
     m_owner = new BookmarkOwner(m_manager, this);
@@ -101,6 +106,7 @@ BookmarkManager::BookmarkManager(QObject *parent)
 
 BookmarkManager::~BookmarkManager()
 {
+    delete m_index;
     delete m_manager;
 }
 
@@ -137,19 +143,27 @@ KBookmarkGroup BookmarkManager::rootGroup()
 
 QList<KBookmark> BookmarkManager::find(const QString &text)
 {
-    QList<KBookmark> list;
+    return m_index->find(text);
+}
 
-    KBookmarkGroup root = rootGroup();
-    if (!root.isNull())
-        for (KBookmark bookmark = root.first(); !bookmark.isNull(); bookmark = root.next(bookmark))
-            find(&list, bookmark, text);
 
-    return list;
+QList<BookmarkMatch> BookmarkManager::match(const QString &text)
+{
+    return m_index->match(text);
 }
 
 
 KBookmark BookmarkManager::bookmarkForUrl(const KUrl &url)
 {
+    KBookmark bookmark = m_index->bookmarkForUrl(url);
+    if (bookmark.isNull())
+        return bookmark;
+
+    // NOTE: bookmarks could have been moved and we are still waiting
+    // for the changed signal: in that case, walk the tree
+    if (BookmarkIndex::urlKey(bookmark.url()) == BookmarkIndex::urlKey(url))
+        return bookmark;
+
     KBookmarkGroup root = rootGroup();
     if (root.isNull())
         return KBookmark();
@@ -158,8 +172,10 @@ KBookmark BookmarkManager::bookmarkForUrl(const KUrl &url)
 }
 
 
-void BookmarkManager::slotBookmarksChanged()
+void BookmarkManager::slotBookmarksChanged(const QString &groupAddress)
 {
+    m_index->updateGroup(groupAddress);
+
     Q_FOREACH(BookmarkToolBar * bookmarkToolBar, m_bookmarkToolBars)
     {
         if (bookmarkToolBar)
@@ -216,33 +232,6 @@ void BookmarkManager::fillBookmarkBar(BookmarkToolBar *toolBar)
 }
 
 
-void BookmarkManager::find(QList<KBookmark> *list, const KBookmark &bookmark, const QString &text)
-{
-    if (bookmark.isGroup())
-    {
-        KBookmarkGroup group = bookmark.toGroup();
-        for (KBookmark bm = group.first(); !bm.isNull(); bm = group.next(bm))
-            find(list, bm, text);
-    }
-    else
-    {
-        QStringList words = text.split(' ');
-        bool matches = true;
-        Q_FOREACH(const QString & word, words)
-        {
-            if (!bookmark.url().url().contains(word, Qt::CaseInsensitive)
-                    && !bookmark.fullText().contains(word, Qt::CaseInsensitive))
-            {
-                matches = false;
-                break;
-            }
-        }
-        if (matches)
-            *list << bookmark;
-    }
-}
-
-
 KBookmark BookmarkManager::bookmarkForUrl(const KBookmark &bookmark, const KUrl &url)
 {
     KBookmark found;
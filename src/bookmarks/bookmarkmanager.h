@@ -43,8 +43,10 @@
 #include <QWeakPointer>
 
 // Forward Declarations
+struct BookmarkMatch;
 class BookmarkToolBar;
 class BookmarkOwner;
+class BookmarkIndex;
 
 class KAction;
 class KActionCollection;
@@ -109,6 +111,12 @@ public:
 
     QList<KBookmark> find(const QString &text);
 
+    /**
+     * Same as find, without touching the bookmarks tree.
+     * Safe to be called from a worker thread.
+     */
+    QList<BookmarkMatch> match(const QString &text);
+
     KBookmark bookmarkForUrl(const KUrl &url);
 
     KBookmark findByAddress(const QString &);
@@ -142,7 +150,7 @@ public Q_SLOTS:
      * @param caller caller that modified the bookmarks
      * @see  KBookmarkManager::changed
      */
-    void slotBookmarksChanged();
+    void slotBookmarksChanged(const QString &groupAddress = QString());
     void fillBookmarkBar(BookmarkToolBar *toolBar);
 
     void slotEditBookmarks();
@@ -158,7 +166,6 @@ Q_SIGNALS:
     void bookmarksUpdated();
 
 private:
-    void find(QList<KBookmark> *list, const KBookmark &bookmark, const QString &text);
     KBookmark bookmarkForUrl(const KBookmark &bookmark, const KUrl &url);
     void copyBookmarkGroup(const KBookmarkGroup &groupToCopy, KBookmarkGroup destGroup);
 
@@ -167,6 +174,8 @@ private:
     KActionCollection *m_actionCollection;
     QList<BookmarkToolBar *> m_bookmarkToolBars;
 
+    BookmarkIndex *m_index;
+
     static QWeakPointer<BookmarkManager> s_bookmarkManager;
 };
 
@@ -139,8 +139,8 @@ QList< QPair<QString, QString> > BookmarkOwner::currentBookmarkList() const
     for (int i = 0; i < tabNumber; ++i)
     {
         QPair<QString, QString> item;
-        item.first = view->webWindow(i)->title();
-        item.second = view->webWindow(i)->url().url();
+        item.first = view->titleAt(i);
+        item.second = view->urlAt(i).url();
         bkList << item;
     }
 
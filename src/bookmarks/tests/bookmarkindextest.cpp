@@ -0,0 +1,166 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "bookmarkindex.h"
+
+// KDE Includes
+#include <KBookmarkManager>
+#include <KTempDir>
+#include <KUrl>
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QtTest>
+
+
+class BookmarkIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void match_data();
+    void match();
+
+    void bookmarkForUrl();
+    void updateGroup();
+
+private:
+    QStringList matchingUrls(const QString &text) const;
+
+    KTempDir *m_tempDir;
+    KBookmarkManager *m_manager;
+    BookmarkIndex *m_index;
+};
+
+
+void BookmarkIndexTest::initTestCase()
+{
+    m_tempDir = new KTempDir;
+    m_manager = KBookmarkManager::managerForFile(m_tempDir->name() + QL1S("bookmarks.xml"), QL1S("rekonqtest"));
+
+    KBookmarkGroup root = m_manager->root();
+    root.addBookmark(QL1S("KDE - Experience Freedom!"), KUrl("http://www.kde.org/"));
+    root.addBookmark(QL1S("rekonq"), KUrl("http://rekonq.kde.org/"));
+
+    KBookmarkGroup news = root.createNewFolder(QL1S("News"));
+    news.addBookmark(QL1S("Planet KDE"), KUrl("http://planetkde.org/"));
+    news.addBookmark(QL1S("LWN.net"), KUrl("http://lwn.net/"));
+
+    root.addBookmark(QL1S("Bookmarking tips"), KUrl("http://www.example.com/tips.html"));
+
+    m_index = new BookmarkIndex(m_manager);
+    m_index->rebuild();
+}
+
+
+void BookmarkIndexTest::cleanupTestCase()
+{
+    delete m_index;
+    delete m_tempDir;
+}
+
+
+QStringList BookmarkIndexTest::matchingUrls(const QString &text) const
+{
+    QStringList urls;
+    Q_FOREACH(const BookmarkMatch & found, m_index->match(text))
+    {
+        urls << found.url;
+    }
+    return urls;
+}
+
+
+void BookmarkIndexTest::match_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("urls");
+
+    // in bookmarks order
+    QTest::newRow("url") << "kde"
+                         << (QStringList() << "http://www.kde.org/" << "http://rekonq.kde.org/" << "http://planetkde.org/");
+    QTest::newRow("title") << "freedom" << (QStringList() << "http://www.kde.org/");
+    QTest::newRow("word prefix") << "experi" << (QStringList() << "http://www.kde.org/");
+    QTest::newRow("inside a word") << "ook" << (QStringList() << "http://www.example.com/tips.html");
+    QTest::newRow("case") << "LWN" << (QStringList() << "http://lwn.net/");
+    QTest::newRow("words") << "planet kde" << (QStringList() << "http://planetkde.org/");
+    QTest::newRow("pieces") << "lwn.net" << (QStringList() << "http://lwn.net/");
+    QTest::newRow("no match") << "phoronix" << QStringList();
+    QTest::newRow("one word not matching") << "kde phoronix" << QStringList();
+}
+
+
+void BookmarkIndexTest::match()
+{
+    QFETCH(QString, text);
+    QFETCH(QStringList, urls);
+
+    QCOMPARE(matchingUrls(text), urls);
+}
+
+
+void BookmarkIndexTest::bookmarkForUrl()
+{
+    QCOMPARE(m_index->bookmarkForUrl(KUrl("http://rekonq.kde.org")).text(), QString("rekonq"));
+    QCOMPARE(m_index->bookmarkForUrl(KUrl("http://lwn.net/")).text(), QString("LWN.net"));
+    QVERIFY(m_index->bookmarkForUrl(KUrl("http://www.phoronix.com/")).isNull());
+}
+
+
+void BookmarkIndexTest::updateGroup()
+{
+    // the third child of the root
+    KBookmarkGroup news = m_manager->findByAddress(QL1S("/2")).toGroup();
+    QCOMPARE(news.text(), QString("News"));
+
+    KBookmark lwn = m_index->bookmarkForUrl(KUrl("http://lwn.net/"));
+    news.deleteBookmark(lwn);
+    news.addBookmark(QL1S("Phoronix"), KUrl("http://www.phoronix.com/"));
+
+    m_index->updateGroup(news.address());
+
+    QCOMPARE(matchingUrls(QL1S("phoronix")), QStringList() << "http://www.phoronix.com/");
+    QVERIFY(matchingUrls(QL1S("lwn")).isEmpty());
+    QVERIFY(m_index->bookmarkForUrl(KUrl("http://lwn.net/")).isNull());
+
+    // the other bookmarks are still there
+    QCOMPARE(matchingUrls(QL1S("kde")).count(), 3);
+    QCOMPARE(matchingUrls(QL1S("tips")), QStringList() << "http://www.example.com/tips.html");
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(BookmarkIndexTest, NoGUI)
+#include "bookmarkindextest.moc"
@@ -0,0 +1,331 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Self Includes
+#include "historyindex.h"
+
+// Local Includes
+#include "searchengine.h"
+
+// Qt Includes
+#include <QDate>
+
+#include <math.h>
+
+// generic algorithms
+#include <QtAlgorithms>
+
+
+static inline quint64 trigramKey(const QChar *c)
+{
+    return (quint64(c[0].unicode()) << 32) | (quint64(c[1].unicode()) << 16) | quint64(c[2].unicode());
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+
+
+HistoryIndex::HistoryIndex()
+    : m_mutex(QMutex::Recursive)
+    , m_nextId(0)
+    , m_deadIds(0)
+    , m_lastResultValid(false)
+{
+}
+
+
+void HistoryIndex::addTrigrams(const QString &text, QSet<quint64> &trigrams)
+{
+    const QString lower = text.toLower();
+    const QChar *c = lower.constData();
+    for (int i = 0; i + 2 < lower.length(); ++i)
+        trigrams.insert(trigramKey(c + i));
+}
+
+
+void HistoryIndex::addItem(const HistoryItem &item)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_lastResultValid = false;
+
+    // one entry per url: a newer visit replaces the old one
+    if (m_ids.contains(item.url))
+        removeItem(m_items.value(m_ids.value(item.url)).item);
+
+    const int id = m_nextId++;
+    m_ids.insert(item.url, id);
+
+    Entry entry;
+    entry.item = item;
+    entry.visitScore = log(item.visitCount);
+    entry.lastVisitDay = item.lastDateTimeVisit.date().toJulianDay();
+    entry.isSearchResult = SearchEngine::isSearchResultUrl(item.url);
+    m_items.insert(id, entry);
+
+    QSet<quint64> trigrams;
+    addTrigrams(item.url, trigrams);
+    addTrigrams(item.title, trigrams);
+
+    // ids are always increasing: appending keeps the postings sorted
+    Q_FOREACH(quint64 key, trigrams)
+    {
+        m_postings[key].append(id);
+    }
+}
+
+
+void HistoryIndex::removeItem(const HistoryItem &item)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QHash<QString, int>::iterator it = m_ids.find(item.url);
+    if (it == m_ids.end())
+        return;
+
+    const int id = it.value();
+    if (!(m_items.value(id).item == item))
+        return;
+
+    m_lastResultValid = false;
+
+    // NOTE: the id is just dropped from the items, the postings still have it.
+    // Queries skip dead ids, and they are removed all at once, when they are too many
+    m_items.remove(id);
+    m_ids.erase(it);
+
+    if (++m_deadIds > m_items.count())
+        compactPostings();
+}
+
+
+void HistoryIndex::compactPostings()
+{
+    QHash<quint64, QVector<int> >::iterator p = m_postings.begin();
+    while (p != m_postings.end())
+    {
+        QVector<int> &ids = p.value();
+
+        // keep the live ids, in the same (sorted) order
+        int live = 0;
+        for (int i = 0; i < ids.count(); ++i)
+        {
+            if (m_items.contains(ids.at(i)))
+                ids[live++] = ids.at(i);
+        }
+
+        if (live == 0)
+        {
+            p = m_postings.erase(p);
+            continue;
+        }
+
+        ids.resize(live);
+        ++p;
+    }
+
+    m_deadIds = 0;
+}
+
+
+HistoryItem HistoryIndex::item(const QString &url) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QHash<QString, int>::const_iterator it = m_ids.constFind(url);
+    if (it == m_ids.constEnd())
+        return HistoryItem();
+    return m_items.value(it.value()).item;
+}
+
+
+void HistoryIndex::setItems(const QList<HistoryItem> &list)
+{
+    QMutexLocker locker(&m_mutex);
+
+    clear();
+
+    m_ids.reserve(list.count());
+    m_items.reserve(list.count());
+
+    // history is sorted in reverse: going backwards, more recent visits win
+    for (int i = list.count() - 1; i >= 0; --i)
+        addItem(list.at(i));
+}
+
+
+void HistoryIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_nextId = 0;
+    m_deadIds = 0;
+    m_ids.clear();
+    m_items.clear();
+    m_postings.clear();
+
+    m_lastQuery.clear();
+    m_lastResult.clear();
+    m_lastResultValid = false;
+}
+
+
+void HistoryIndex::updateSearchResults()
+{
+    QMutexLocker locker(&m_mutex);
+
+    QHash<int, Entry>::iterator it;
+    for (it = m_items.begin(); it != m_items.end(); ++it)
+        it.value().isSearchResult = SearchEngine::isSearchResultUrl(it.value().item.url);
+}
+
+
+bool HistoryIndex::matches(const HistoryItem &item, const QStringList &words)
+{
+    Q_FOREACH(const QString & word, words)
+    {
+        if (!item.url.contains(word, Qt::CaseInsensitive)
+                && !item.title.contains(word, Qt::CaseInsensitive))
+            return false;
+    }
+    return true;
+}
+
+
+QVector<int> HistoryIndex::candidates(const QStringList &words) const
+{
+    // every trigram of every word has to show up in the url or in the title
+    QSet<quint64> trigrams;
+    Q_FOREACH(const QString & word, words)
+    {
+        addTrigrams(word, trigrams);
+    }
+
+    QList<const QVector<int> *> lists;
+    Q_FOREACH(quint64 key, trigrams)
+    {
+        QHash<quint64, QVector<int> >::const_iterator p = m_postings.constFind(key);
+        if (p == m_postings.constEnd())
+            return QVector<int>();
+        lists << &p.value();
+    }
+
+    if (lists.isEmpty())
+    {
+        // query too short for the index: check everything
+        QVector<int> all;
+        all.reserve(m_ids.count());
+        Q_FOREACH(int id, m_ids)
+        {
+            all.append(id);
+        }
+        qSort(all);
+        return all;
+    }
+
+    // start from the shortest list, it bounds the result
+    int shortest = 0;
+    for (int i = 1; i < lists.count(); ++i)
+    {
+        if (lists.at(i)->count() < lists.at(shortest)->count())
+            shortest = i;
+    }
+    lists.swap(0, shortest);
+
+    QVector<int> result = *lists.at(0);
+    for (int i = 1; i < lists.count() && !result.isEmpty(); ++i)
+    {
+        const QVector<int> &other = *lists.at(i);
+        QVector<int> merged;
+        merged.reserve(result.count());
+
+        QVector<int>::const_iterator a = result.constBegin();
+        QVector<int>::const_iterator b = other.constBegin();
+        while (a != result.constEnd() && b != other.constEnd())
+        {
+            if (*a < *b)
+                ++a;
+            else if (*b < *a)
+                ++b;
+            else
+            {
+                merged.append(*a);
+                ++a;
+                ++b;
+            }
+        }
+        result = merged;
+    }
+
+    return result;
+}
+
+
+QList<HistoryItem> HistoryIndex::find(const QString &text, QList<qreal> *relevances, bool skipSearchResults)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const QStringList words = text.split(QL1C(' '), QString::SkipEmptyParts);
+
+    // typing one more char can just narrow the previous result
+    QVector<int> ids;
+    if (m_lastResultValid && !m_lastQuery.isEmpty() && text.startsWith(m_lastQuery, Qt::CaseInsensitive))
+        ids = m_lastResult;
+    else
+        ids = candidates(words);
+
+    // same as HistoryItem::relevance(), without asking the time for every item
+    const int today = QDate::currentDate().toJulianDay();
+
+    QVector<int> result;
+    QList<HistoryItem> list;
+    Q_FOREACH(int id, ids)
+    {
+        // removed items can still be in the postings
+        QHash<int, Entry>::const_iterator it = m_items.constFind(id);
+        if (it == m_items.constEnd())
+            continue;
+
+        const Entry &entry = it.value();
+        if (matches(entry.item, words))
+        {
+            // the cached result keeps them all: it does not depend on the filter
+            result.append(id);
+            if (skipSearchResults && entry.isSearchResult)
+                continue;
+
+            list << entry.item;
+            if (relevances)
+                *relevances << entry.visitScore - log(qMax(today - entry.lastVisitDay, 0) + 1);
+        }
+    }
+
+    m_lastQuery = text;
+    m_lastResult = result;
+    m_lastResultValid = true;
+
+    return list;
+}
@@ -0,0 +1,125 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+#ifndef HISTORY_INDEX_H
+#define HISTORY_INDEX_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "historymanager.h"
+
+// Qt Includes
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/**
+ * In memory trigram index of the history items, used to answer
+ * the url bar queries without scanning the whole history.
+ *
+ * Every item gets an id that is never reused, so that the posting
+ * lists (the ids of the items containing a trigram) stay sorted
+ * and can be intersected in linear time.
+ * Removed items leave dead ids in the posting lists, skipped by the
+ * queries: they are dropped all at once when they outnumber the live ones.
+ * The last query result is kept around: when the user keeps on typing,
+ * the new result is a subset of it and we just have to refine it.
+ *
+ * The visit part of the items relevance is computed once, when they
+ * are (re)visited; the age part is applied lazily at query time.
+ * Whether an item is a search engine result page is decided once, too,
+ * and updated just when the favorite engines change.
+ *
+ * The index is guarded by a mutex: the url bar queries it from a worker thread.
+ *
+ */
+class REKONQ_TESTS_EXPORT HistoryIndex
+{
+public:
+    HistoryIndex();
+
+    void addItem(const HistoryItem &item);
+    void removeItem(const HistoryItem &item);
+    void setItems(const QList<HistoryItem> &list);
+    void clear();
+
+    // NOTE: call this from the GUI thread, when the favorite search engines change
+    void updateSearchResults();
+
+    QList<HistoryItem> find(const QString &text, QList<qreal> *relevances = 0, bool skipSearchResults = false);
+
+    int count() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_ids.count();
+    }
+
+    bool contains(const QString &url) const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_ids.contains(url);
+    }
+
+    HistoryItem item(const QString &url) const;
+
+private:
+    struct Entry
+    {
+        HistoryItem item;
+        qreal visitScore;
+        int lastVisitDay;
+        bool isSearchResult;
+    };
+
+    QVector<int> candidates(const QStringList &words) const;
+    static bool matches(const HistoryItem &item, const QStringList &words);
+    static void addTrigrams(const QString &text, QSet<quint64> &trigrams);
+
+    // drop the ids of the removed items from the posting lists
+    void compactPostings();
+
+    mutable QMutex m_mutex;
+
+    int m_nextId;
+    int m_deadIds;
+    QHash<QString, int> m_ids;
+    QHash<int, Entry> m_items;
+    QHash<quint64, QVector<int> > m_postings;
+
+    QString m_lastQuery;
+    QVector<int> m_lastResult;
+    bool m_lastResultValid;
+};
+
+
+#endif // HISTORY_INDEX_H
@@ -34,6 +34,7 @@
 #include "rekonq.h"
 
 // Local Includes
+#include "historyindex.h"
 #include "historymodels.h"
 #include "autosaver.h"
 
@@ -41,6 +42,7 @@
 #include <KStandardDirs>
 #include <KLocale>
 #include <KCompletion>
+#include <KSaveFile>
 
 // Qt Includes
 #include <QApplication>
@@ -48,12 +50,15 @@
 #include <QUrl>
 #include <QDate>
 #include <QDateTime>
+#include <QSet>
 #include <QString>
 #include <QFile>
 #include <QDataStream>
 #include <QBuffer>
-#include <QTemporaryFile>
 #include <QTimer>
+#include <QVector>
+
+#include <QtConcurrentRun>
 
 #include <QClipboard>
 
@@ -63,6 +68,59 @@
 
 static const unsigned int HISTORY_VERSION = 25;
 
+// NOTE
+// The history file is a log: every visit appends the updated item,
+// every removal appends a "tombstone" record with the removed url.
+// Older rekonq versions just skip the records they don't know.
+static const unsigned int HISTORY_TOMBSTONE = 1000;
+
+// rewrite the log when it contains more dead records than these
+// (and than live ones)
+static const int HISTORY_DEAD_RECORDS_LIMIT = 1000;
+
+
+static QByteArray itemRecord(const HistoryItem &item)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << HISTORY_VERSION << item.url << item.firstDateTimeVisit << item.lastDateTimeVisit << item.title << item.visitCount;
+    return data;
+}
+
+
+static QByteArray tombstoneRecord(const QString &url)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << HISTORY_TOMBSTONE << url;
+    return data;
+}
+
+
+// NOTE: this runs in a worker thread
+static bool writeHistoryFile(const QString &historyFilePath, const QList<HistoryItem> &history)
+{
+    KSaveFile historyFile(historyFilePath);
+    if (!historyFile.open(QIODevice::WriteOnly))
+    {
+        kDebug() << "Unable to open history file for saving" << historyFilePath;
+        return false;
+    }
+
+    QDataStream out(&historyFile);
+    for (int i = history.count() - 1; i >= 0; --i)
+    {
+        out << itemRecord(history.at(i));
+    }
+
+    if (!historyFile.finalize())
+    {
+        kDebug() << "History: error writing history." << historyFile.errorString();
+        return false;
+    }
+    return true;
+}
+
 
 QWeakPointer<HistoryManager> HistoryManager::s_historyManager;
 
@@ -77,6 +135,357 @@ HistoryManager *HistoryManager::self()
 }
 
 
+// NOTE: this runs in a worker thread
+static HistoryLog readHistoryFile(const QString &historyFilePath)
+{
+    HistoryLog log;
+    log.deadRecords = 0;
+
+    QFile historyFile(historyFilePath);
+    if (!historyFile.exists())
+        return log;
+    if (!historyFile.open(QFile::ReadOnly))
+    {
+        kDebug() << "Unable to open history file" << historyFile.fileName();
+        return log;
+    }
+
+    // NOTE: records are read right from the mapped file, when possible
+    QByteArray data;
+    uchar *mappedFile = historyFile.map(0, historyFile.size());
+    if (mappedFile)
+        data = QByteArray::fromRawData(reinterpret_cast<const char *>(mappedFile), historyFile.size());
+    else
+        data = historyFile.readAll();
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream in(&buffer);
+
+    // the log holds visits and removals in the order they happened:
+    // the last record of an url wins. Dead records get an invalid date
+    QVector<HistoryItem> records;
+    QHash<QString, int> positions;
+    int recordsCount = 0;
+
+    while (!buffer.atEnd())
+    {
+        quint32 length;
+        in >> length;
+        if (in.status() != QDataStream::Ok || length > quint32(buffer.size() - buffer.pos()))
+        {
+            kDebug() << "History file is truncated";
+            break;
+        }
+
+        const qint64 next = buffer.pos() + length;
+        ++recordsCount;
+
+        quint32 version = 0;
+        if (length >= sizeof(version))
+            in >> version;
+
+        HistoryItem item;
+
+        switch (version)
+        {
+        case HISTORY_VERSION:   // default case
+            in >> item.url;
+            in >> item.firstDateTimeVisit;
+            in >> item.lastDateTimeVisit;
+            in >> item.title;
+            in >> item.visitCount;
+            break;
+
+        case 24:                // this was history structure for rekonq < 0.8
+            in >> item.url;
+            in >> item.lastDateTimeVisit;
+            in >> item.title;
+            in >> item.visitCount;
+            item.firstDateTimeVisit = item.lastDateTimeVisit;
+            break;
+
+        case 23:                // this will be used to upgrade previous structure...
+            in >> item.url;
+            in >> item.lastDateTimeVisit;
+            in >> item.title;
+            item.visitCount = 1;
+            item.firstDateTimeVisit = item.lastDateTimeVisit;
+            break;
+
+        case HISTORY_TOMBSTONE:
+            in >> item.url;
+            if (positions.contains(item.url))
+                records[positions.take(item.url)].lastDateTimeVisit = QDateTime();
+            break;
+
+        default:
+            break;
+        };
+
+        buffer.seek(next);
+
+        if (!item.lastDateTimeVisit.isValid())
+            continue;
+
+        QHash<QString, int>::iterator it = positions.find(item.url);
+        if (it != positions.end())
+        {
+            HistoryItem &previous = records[it.value()];
+            if (item.title.isEmpty())
+                item.title = previous.title;
+            previous.lastDateTimeVisit = QDateTime();
+            it.value() = records.count();
+        }
+        else
+        {
+            positions.insert(item.url, records.count());
+        }
+        records.append(item);
+    }
+
+    buffer.close();
+    if (mappedFile)
+        historyFile.unmap(mappedFile);
+
+    // Double check that the history is sorted
+    QList<HistoryItem> &list = log.items;
+    bool needToSort = false;
+    for (int i = records.count() - 1; i >= 0; --i)
+    {
+        const HistoryItem &item = records.at(i);
+        if (!item.lastDateTimeVisit.isValid())
+            continue;
+
+        if (!needToSort && !list.isEmpty() && item < list.last())
+            needToSort = true;
+
+        list.append(item);
+    }
+    if (needToSort)
+        qSort(list.begin(), list.end());
+
+    log.deadRecords = recordsCount - list.count();
+
+    return log;
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+static inline int lowBit(int i)
+{
+    return i & -i;
+}
+
+
+HistoryList::HistoryList()
+    : m_count(0)
+{
+    // NOTE: the tree is 1-based
+    m_liveTree.append(0);
+}
+
+
+int HistoryList::liveSlotsUpTo(int slot) const
+{
+    int sum = 0;
+    for (int i = slot + 1; i > 0; i -= lowBit(i))
+        sum += m_liveTree.at(i);
+    return sum;
+}
+
+
+int HistoryList::slotAt(int row) const
+{
+    // the k-th live slot, counting from the oldest one
+    int k = m_count - row;
+    int pos = 0;
+
+    int step = 1;
+    while (step * 2 < m_liveTree.count())
+        step *= 2;
+
+    for (; step > 0; step /= 2)
+    {
+        if (pos + step < m_liveTree.count() && m_liveTree.at(pos + step) < k)
+        {
+            pos += step;
+            k -= m_liveTree.at(pos);
+        }
+    }
+
+    return pos;
+}
+
+
+const HistoryItem &HistoryList::at(int row) const
+{
+    Q_ASSERT(row >= 0 && row < m_count);
+    return m_items.at(slotAt(row));
+}
+
+
+const HistoryItem &HistoryList::last() const
+{
+    return at(m_count - 1);
+}
+
+
+int HistoryList::row(const QString &url) const
+{
+    QHash<QString, int>::const_iterator it = m_slots.constFind(url);
+    if (it == m_slots.constEnd())
+        return -1;
+
+    return m_count - liveSlotsUpTo(it.value());
+}
+
+
+HistoryItem HistoryList::item(const QString &url) const
+{
+    QHash<QString, int>::const_iterator it = m_slots.constFind(url);
+    if (it == m_slots.constEnd())
+        return HistoryItem();
+
+    return m_items.at(it.value());
+}
+
+
+void HistoryList::prepend(const HistoryItem &item)
+{
+    Q_ASSERT(!m_slots.contains(item.url));
+
+    m_items.append(item);
+    m_slots.insert(item.url, m_items.count() - 1);
+    m_count++;
+
+    // the new tree node counts the slots in (i - lowBit(i), i]: itself and what its children count
+    const int i = m_items.count();
+    int live = 1;
+    for (int j = i - 1; j > i - lowBit(i); j -= lowBit(j))
+        live += m_liveTree.at(j);
+    m_liveTree.append(live);
+}
+
+
+int HistoryList::moveToTop(const HistoryItem &item)
+{
+    const int slot = m_slots.value(item.url, -1);
+    Q_ASSERT(slot != -1);
+
+    const int previousRow = m_count - liveSlotsUpTo(slot);
+    removeSlot(slot);
+    prepend(item);
+
+    return previousRow;
+}
+
+
+HistoryItem HistoryList::takeAt(int row)
+{
+    const int slot = slotAt(row);
+    const HistoryItem item = m_items.at(slot);
+    removeSlot(slot);
+    return item;
+}
+
+
+HistoryItem HistoryList::takeLast()
+{
+    return takeAt(m_count - 1);
+}
+
+
+void HistoryList::removeSlot(int slot)
+{
+    m_slots.remove(m_items.at(slot).url);
+    m_items[slot] = HistoryItem();
+    m_count--;
+
+    for (int i = slot + 1; i < m_liveTree.count(); i += lowBit(i))
+        m_liveTree[i]--;
+
+    // dead slots are kept until they are too many
+    if (m_items.count() - m_count > m_count)
+        compact();
+}
+
+
+void HistoryList::compact()
+{
+    QVector<HistoryItem> items;
+    items.reserve(m_count);
+
+    for (int slot = 0; slot < m_items.count(); ++slot)
+    {
+        const HistoryItem &item = m_items.at(slot);
+        if (m_slots.value(item.url, -1) != slot)
+            continue;
+
+        m_slots[item.url] = items.count();
+        items.append(item);
+    }
+    m_items = items;
+
+    // every slot is live now: build the tree bottom up
+    m_liveTree.fill(1, m_items.count() + 1);
+    m_liveTree[0] = 0;
+    for (int i = 1; i < m_liveTree.count(); ++i)
+    {
+        const int parent = i + lowBit(i);
+        if (parent < m_liveTree.count())
+            m_liveTree[parent] += m_liveTree.at(i);
+    }
+}
+
+
+void HistoryList::clear()
+{
+    m_items.clear();
+    m_liveTree.resize(1);
+    m_slots.clear();
+    m_count = 0;
+}
+
+
+void HistoryList::setItems(const QList<HistoryItem> &list)
+{
+    clear();
+
+    m_items.reserve(list.count());
+    m_liveTree.reserve(list.count() + 1);
+    m_slots.reserve(list.count());
+
+    // oldest first: a more recent visit of the same url wins
+    for (int i = list.count() - 1; i >= 0; --i)
+    {
+        const HistoryItem &item = list.at(i);
+        if (m_slots.contains(item.url))
+            moveToTop(item);
+        else
+            prepend(item);
+    }
+}
+
+
+QList<HistoryItem> HistoryList::toList() const
+{
+    QList<HistoryItem> list;
+    list.reserve(m_count);
+
+    for (int slot = m_items.count() - 1; slot >= 0; --slot)
+    {
+        const HistoryItem &item = m_items.at(slot);
+        if (m_slots.value(item.url, -1) == slot)
+            list.append(item);
+    }
+
+    return list;
+}
+
+
 // ----------------------------------------------------------------------------------------------
 
 
@@ -84,29 +493,52 @@ HistoryManager::HistoryManager(QObject *parent)
     : QObject(parent)
     , m_saveTimer(new AutoSaver(this))
     , m_historyLimit(0)
+    , m_loaded(false)
+    , m_deadRecords(0)
+    , m_compactedDeadRecords(0)
+    , m_rewriteNeeded(false)
+    , m_historyIndex(new HistoryIndex)
     , m_historyTreeModel(0)
 {
     connect(this, SIGNAL(entryAdded(HistoryItem)), m_saveTimer, SLOT(changeOccurred()));
     connect(this, SIGNAL(entryRemoved(HistoryItem)), m_saveTimer, SLOT(changeOccurred()));
+    connect(this, SIGNAL(entryMoved(HistoryItem,int)), m_saveTimer, SLOT(changeOccurred()));
     connect(m_saveTimer, SIGNAL(saveNeeded()), this, SLOT(save()));
-
-    load();
+    connect(&m_compactionWatcher, SIGNAL(finished()), this, SLOT(compactionFinished()));
+    connect(&m_loadWatcher, SIGNAL(finished()), this, SLOT(historyLoaded()));
 
     HistoryModel *historyModel = new HistoryModel(this, this);
     m_historyFilterModel = new HistoryFilterModel(historyModel, this);
     m_historyTreeModel = new HistoryTreeModel(m_historyFilterModel, this);
+
+    // NOTE: models are empty until history has been loaded
+    load();
 }
 
 
 HistoryManager::~HistoryManager()
 {
+    waitUntilReady();
+
     if (ReKonfig::expireHistory() == 4)
     {
         m_history.clear();
-        save();
-        return;
+        m_rewriteNeeded = true;
+    }
+    else
+    {
+        m_saveTimer->saveIfNeccessary();
     }
-    m_saveTimer->saveIfNeccessary();
+
+    // we are quitting: wait for the compaction, then write what's left
+    m_compactionWatcher.waitForFinished();
+
+    if (m_rewriteNeeded)
+        writeHistoryFile(KStandardDirs::locateLocal("appdata" , "history"), m_history.toList());
+    else
+        appendPendingRecords();
+
+    delete m_historyIndex;
 
     kDebug() << "bye bye history...";
 }
@@ -114,7 +546,7 @@ HistoryManager::~HistoryManager()
 
 bool HistoryManager::historyContains(const QString &url) const
 {
-    return m_historyFilterModel->historyContains(url);
+    return m_historyIndex->contains(url);
 }
 
 
@@ -140,28 +572,36 @@ void HistoryManager::addHistoryEntry(const KUrl &url, const QString &title)
     urlToClean.setHost(urlToClean.host().toLower());
     QString urlString = urlToClean.toString();
 
-    HistoryItem item;
+    addVisit(HistoryItem(urlString, QDateTime::currentDateTime(), title));
+}
 
+
+void HistoryManager::addVisit(const HistoryItem &visit)
+{
     // NOTE
     // check if the url has just been visited.
-    // if so, remove previous entry from history, update and prepend it
-    if (historyContains(urlString))
+    // if so, update its entry and move it on top of the history
+    if (m_history.contains(visit.url))
     {
-        int index = m_historyFilterModel->historyLocation(urlString);
-        item = m_history.at(index);
-        m_history.removeOne(item);
-        emit entryRemoved(item);
+        HistoryItem item = m_history.item(visit.url);
+        item.lastDateTimeVisit = visit.lastDateTimeVisit;
+        item.visitCount += visit.visitCount;
 
-        item.lastDateTimeVisit = QDateTime::currentDateTime();
-        item.visitCount++;
-    }
-    else
-    {
-        item = HistoryItem(urlString, QDateTime::currentDateTime(), title);
+        const int row = m_history.moveToTop(item);
+        m_historyIndex->addItem(item);
+
+        // the previous record of this url is dead now
+        m_pendingRecords << itemRecord(item);
+        m_deadRecords++;
+
+        emit entryMoved(item, row);
+        return;
     }
 
-    m_history.prepend(item);
-    emit entryAdded(item);
+    m_history.prepend(visit);
+    m_historyIndex->addItem(visit);
+    m_pendingRecords << itemRecord(visit);
+    emit entryAdded(visit);
 
     if (m_history.count() == 1)
         checkForExpired();
@@ -170,21 +610,21 @@ void HistoryManager::addHistoryEntry(const KUrl &url, const QString &title)
 
 void HistoryManager::setHistory(const QList<HistoryItem> &history, bool loadedAndSorted)
 {
-    m_history = history;
+    QList<HistoryItem> list = history;
 
     // verify that it is sorted by date
     if (!loadedAndSorted)
-        qSort(m_history.begin(), m_history.end());
+        qSort(list.begin(), list.end());
 
+    m_history.setItems(list);
     checkForExpired();
 
-    if (loadedAndSorted)
-    {
-        m_lastSavedUrl = m_history.value(0).url;
-    }
-    else
+    m_historyIndex->setItems(m_history.toList());
+
+    if (!loadedAndSorted)
     {
-        m_lastSavedUrl.clear();
+        // the log has nothing to do with the new history: rewrite it
+        m_rewriteNeeded = true;
         m_saveTimer->changeOccurred();
     }
 
@@ -217,7 +657,8 @@ void HistoryManager::checkForExpired()
             break;
         HistoryItem item = m_history.takeLast();
         // remove from saved file also
-        m_lastSavedUrl.clear();
+        logRemoval(item);
+        m_historyIndex->removeItem(item);
         emit entryRemoved(item);
     }
 
@@ -228,67 +669,49 @@ void HistoryManager::checkForExpired()
 
 void HistoryManager::removeHistoryEntry(const KUrl &url, const QString &title)
 {
-    HistoryItem item;
-    for (int i = 0; i < m_history.count(); ++i)
-    {
-        if (url == m_history.at(i).url
-                && (title.isEmpty() || title == m_history.at(i).title))
-        {
-            item = m_history.at(i);
-            m_lastSavedUrl.clear();
-            m_history.removeOne(item);
-            emit entryRemoved(item);
-            break;
-        }
-    }
+    const int row = m_history.row(url.toString());
+    if (row == -1)
+        return;
+
+    if (!title.isEmpty() && title != m_history.at(row).title)
+        return;
+
+    HistoryItem item = m_history.takeAt(row);
+    logRemoval(item);
+    m_historyIndex->removeItem(item);
+    emit entryRemoved(item);
 }
 
 
 void HistoryManager::removeHistoryLocationEntry(int value)
 {
-    if (value < 0)
+    if (value < 0 || value >= m_history.count())
         return;
-    
-    HistoryItem item = m_history.at(value);
-    m_lastSavedUrl.clear();
-    m_history.removeOne(item);
+
+    HistoryItem item = m_history.takeAt(value);
+    logRemoval(item);
+    m_historyIndex->removeItem(item);
     emit entryRemoved(item);
 }
 
 
-QList<HistoryItem> HistoryManager::find(const QString &text)
+QList<HistoryItem> HistoryManager::find(const QString &text, QList<qreal> *relevances, bool skipSearchResults)
 {
-    QList<HistoryItem> list;
+    return m_historyIndex->find(text, relevances, skipSearchResults);
+}
 
-    QStringList urlKeys = m_historyFilterModel->keys();
-    Q_FOREACH(const QString & url, urlKeys)
-    {
-        int index = m_historyFilterModel->historyLocation(url);
-        HistoryItem item = m_history.at(index);
 
-        QStringList words = text.split(' ');
-        bool matches = true;
-        Q_FOREACH(const QString & word, words)
-        {
-            if (!url.contains(word, Qt::CaseInsensitive)
-                    && !item.title.contains(word, Qt::CaseInsensitive))
-            {
-                matches = false;
-                break;
-            }
-        }
-        if (matches)
-            list << item;
-    }
-
-    return list;
+void HistoryManager::updateSearchResults()
+{
+    m_historyIndex->updateSearchResults();
 }
 
 
 void HistoryManager::clear()
 {
     m_history.clear();
-    m_lastSavedUrl.clear();
+    m_historyIndex->clear();
+    m_rewriteNeeded = true;
     m_saveTimer->changeOccurred();
     m_saveTimer->saveIfNeccessary();
     historyReset();
@@ -326,160 +749,150 @@ void HistoryManager::load()
     loadSettings();
 
     QString historyFilePath = KStandardDirs::locateLocal("appdata" , "history");
-    QFile historyFile(historyFilePath);
-    if (!historyFile.exists())
-        return;
-    if (!historyFile.open(QFile::ReadOnly))
-    {
-        kDebug() << "Unable to open history file" << historyFile.fileName();
+    m_loadWatcher.setFuture(QtConcurrent::run(readHistoryFile, historyFilePath));
+}
+
+
+void HistoryManager::waitUntilReady()
+{
+    if (m_loaded)
         return;
-    }
 
-    QList<HistoryItem> list;
-    QDataStream in(&historyFile);
-    // Double check that the history file is sorted as it is read in
-    bool needToSort = false;
-    HistoryItem lastInsertedItem;
-    QByteArray data;
-    QDataStream stream;
-    QBuffer buffer;
-    stream.setDevice(&buffer);
-    while (!historyFile.atEnd())
-    {
-        in >> data;
-        buffer.close();
-        buffer.setBuffer(&data);
-        buffer.open(QIODevice::ReadOnly);
-        quint32 version;
-        stream >> version;
+    m_loadWatcher.waitForFinished();
+    historyLoaded();
+}
 
-        HistoryItem item;
 
-        switch (version)
-        {
-        case HISTORY_VERSION:   // default case
-            stream >> item.url;
-            stream >> item.firstDateTimeVisit;
-            stream >> item.lastDateTimeVisit;
-            stream >> item.title;
-            stream >> item.visitCount;
-            break;
+void HistoryManager::historyLoaded()
+{
+    if (m_loaded)
+        return;
 
-        case 24:                // this was history structure for rekonq < 0.8
-            stream >> item.url;
-            stream >> item.lastDateTimeVisit;
-            stream >> item.title;
-            stream >> item.visitCount;
-            item.firstDateTimeVisit = item.lastDateTimeVisit;
-            break;
+    m_loaded = true;
 
-        case 23:                // this will be used to upgrade previous structure...
-            stream >> item.url;
-            stream >> item.lastDateTimeVisit;
-            stream >> item.title;
-            item.visitCount = 1;
-            item.firstDateTimeVisit = item.lastDateTimeVisit;
-            break;
+    // history has been cleared (or replaced) in the meantime
+    if (m_rewriteNeeded)
+    {
+        m_removedWhileLoading.clear();
+        m_saveTimer->changeOccurred();
+        emit historyReady();
+        return;
+    }
 
-        default:
-            continue;
-        };
+    HistoryLog log = m_loadWatcher.result();
 
-        if (!item.lastDateTimeVisit.isValid())
-            continue;
+    // NOTE: visits happened while loading get merged in the loaded history,
+    // their (partial) records are written again.
+    // Removals are applied to it first, their tombstones kept
+    QList<HistoryItem> visits = m_history.toList();
+    m_pendingRecords.clear();
+    m_deadRecords = log.deadRecords;
 
-        if (item == lastInsertedItem)
+    if (!m_removedWhileLoading.isEmpty())
+    {
+        const QSet<QString> removedUrls = m_removedWhileLoading.toSet();
+
+        QList<HistoryItem>::iterator it = log.items.begin();
+        while (it != log.items.end())
         {
-            if (lastInsertedItem.title.isEmpty() && !list.isEmpty())
-                list[0].title = item.title;
-            continue;
+            if (removedUrls.contains(it->url))
+                it = log.items.erase(it);
+            else
+                ++it;
         }
 
-        if (!needToSort && !list.isEmpty() && lastInsertedItem < item)
-            needToSort = true;
-
-        list.prepend(item);
-        lastInsertedItem = item;
+        Q_FOREACH(const QString & url, m_removedWhileLoading)
+        {
+            m_pendingRecords << tombstoneRecord(url);
+            m_deadRecords += 2;
+        }
+        m_removedWhileLoading.clear();
     }
-    if (needToSort)
-        qSort(list.begin(), list.end());
 
-    setHistory(list, true);
+    setHistory(log.items, true);
 
-    // If we had to sort re-write the whole history sorted
-    if (needToSort)
-    {
-        m_lastSavedUrl.clear();
+    for (int i = visits.count() - 1; i >= 0; --i)
+        addVisit(visits.at(i));
+
+    if (!m_pendingRecords.isEmpty())
         m_saveTimer->changeOccurred();
-    }
+
+    emit historyReady();
 }
 
 
 void HistoryManager::save()
 {
-    bool saveAll = m_lastSavedUrl.isEmpty();
-    int first = m_history.count() - 1;
-    if (!saveAll)
+    // records written in the meantime are appended to the compacted file
+    // (or to the loaded one)
+    if (!m_loaded || m_compactionWatcher.isRunning())
+        return;
+
+    if (m_rewriteNeeded
+            || (m_deadRecords > HISTORY_DEAD_RECORDS_LIMIT && m_deadRecords > m_history.count()))
     {
-        // find the first one to save
-        for (int i = 0; i < m_history.count(); ++i)
-        {
-            if (m_history.at(i).url == m_lastSavedUrl)
-            {
-                first = i - 1;
-                break;
-            }
-        }
-    }
-    if (first == m_history.count() - 1)
-        saveAll = true;
+        m_rewriteNeeded = false;
+        m_pendingRecords.clear();
 
-    QString historyFilePath = KStandardDirs::locateLocal("appdata" , "history");
-    QFile historyFile(historyFilePath);
+        // records dying while writing are still there after the compaction
+        m_compactedDeadRecords = m_deadRecords;
 
-    // When saving everything use a temporary file to prevent possible data loss.
-    QTemporaryFile tempFile;
-    tempFile.setAutoRemove(false);
-    bool open = false;
-    if (saveAll)
-    {
-        open = tempFile.open();
-    }
-    else
-    {
-        open = historyFile.open(QFile::Append);
+        QString historyFilePath = KStandardDirs::locateLocal("appdata" , "history");
+        m_compactionWatcher.setFuture(QtConcurrent::run(writeHistoryFile, historyFilePath, m_history.toList()));
+        return;
     }
 
-    if (!open)
+    appendPendingRecords();
+
+    emit historySaved();
+}
+
+
+void HistoryManager::compactionFinished()
+{
+    if (m_compactionWatcher.result())
+        m_deadRecords -= m_compactedDeadRecords;
+    m_compactedDeadRecords = 0;
+
+    if (m_rewriteNeeded || !m_pendingRecords.isEmpty())
     {
-        kDebug() << "Unable to open history file for saving"
-                 << (saveAll ? tempFile.fileName() : historyFile.fileName());
+        save();
         return;
     }
 
-    QDataStream out(saveAll ? &tempFile : &historyFile);
-    for (int i = first; i >= 0; --i)
+    emit historySaved();
+}
+
+
+void HistoryManager::appendPendingRecords()
+{
+    if (m_pendingRecords.isEmpty())
+        return;
+
+    QString historyFilePath = KStandardDirs::locateLocal("appdata" , "history");
+    QFile historyFile(historyFilePath);
+    if (!historyFile.open(QFile::Append))
     {
-        QByteArray data;
-        QDataStream stream(&data, QIODevice::WriteOnly);
-        HistoryItem item = m_history.at(i);
-        stream << HISTORY_VERSION << item.url << item.firstDateTimeVisit << item.lastDateTimeVisit << item.title << item.visitCount;
-        out << data;
+        kDebug() << "Unable to open history file for saving" << historyFile.fileName();
+        return;
     }
-    tempFile.close();
 
-    if (saveAll)
+    QDataStream out(&historyFile);
+    Q_FOREACH(const QByteArray & record, m_pendingRecords)
     {
-        if (historyFile.exists() && !historyFile.remove())
-        {
-            kDebug() << "History: error removing old history." << historyFile.errorString();
-        }
-        if (!tempFile.rename(historyFile.fileName()))
-        {
-            kDebug() << "History: error moving new history over old." << tempFile.errorString() << historyFile.fileName();
-        }
+        out << record;
     }
-    m_lastSavedUrl = m_history.value(0).url;
+    m_pendingRecords.clear();
+}
 
-    emit historySaved();
+
+void HistoryManager::logRemoval(const HistoryItem &item)
+{
+    // both the tombstone and the removed item record are dead
+    m_pendingRecords << tombstoneRecord(item.url);
+    m_deadRecords += 2;
+
+    // the url could be in the history still loading, too
+    if (!m_loaded)
+        m_removedWhileLoading << item.url;
 }
@@ -30,13 +30,19 @@
 #define HISTORY_H
 
 
+// Rekonq Includes
+#include "rekonq_defines.h"
+
 // KDE Includes
 #include <KUrl>
 
 // Qt Includes
 #include <QDateTime>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QObject>
+#include <QStringList>
+#include <QVector>
 #include <QWebHistory>
 
 #include <math.h>
@@ -44,6 +50,7 @@
 // Forward Declarations
 class AutoSaver;
 class HistoryFilterModel;
+class HistoryIndex;
 class HistoryTreeModel;
 
 class QWebHistory;
@@ -101,6 +108,88 @@ public:
 // ---------------------------------------------------------------------------------------------------------------
 
 
+/**
+ * The history as read from disk
+ *
+ */
+struct HistoryLog
+{
+    QList<HistoryItem> items;
+    int deadRecords;
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------
+
+
+/**
+ * The history items, most recent first, keyed by url.
+ *
+ * Items are stored by visit, oldest first: a revisited url is just appended again
+ * and its old slot is left dead, dropped when dead slots outnumber the live ones.
+ * A Fenwick tree counting the live slots maps rows to slots (and back)
+ * in logarithmic time, so moving an item on top never shifts the others.
+ *
+ */
+class REKONQ_TESTS_EXPORT HistoryList
+{
+public:
+    HistoryList();
+
+    int count() const
+    {
+        return m_count;
+    }
+
+    bool isEmpty() const
+    {
+        return m_count == 0;
+    }
+
+    bool contains(const QString &url) const
+    {
+        return m_slots.contains(url);
+    }
+
+    // row 0 is the most recent item
+    const HistoryItem &at(int row) const;
+    const HistoryItem &last() const;
+
+    // the row of url, -1 if not there
+    int row(const QString &url) const;
+    HistoryItem item(const QString &url) const;
+
+    // add an item with a new url on top
+    void prepend(const HistoryItem &item);
+
+    // replace the item of the same url, moving it on top. Returns its previous row
+    int moveToTop(const HistoryItem &item);
+
+    HistoryItem takeAt(int row);
+    HistoryItem takeLast();
+
+    void clear();
+
+    // from and to a list sorted by visit, most recent first
+    void setItems(const QList<HistoryItem> &list);
+    QList<HistoryItem> toList() const;
+
+private:
+    int slotAt(int row) const;
+    int liveSlotsUpTo(int slot) const;
+    void removeSlot(int slot);
+    void compact();
+
+    QVector<HistoryItem> m_items;
+    QVector<int> m_liveTree;
+    QHash<QString, int> m_slots;
+    int m_count;
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------
+
+
 /**
  * THE History Manager:
  * It manages rekonq history
@@ -121,13 +210,43 @@ public:
     ~HistoryManager();
 
     bool historyContains(const QString &url) const;
+
+    // the row of url in the history, -1 if it is not there
+    int historyRow(const QString &url) const
+    {
+        return m_history.row(url);
+    }
     void addHistoryEntry(const KUrl &url, const QString &title);
     void removeHistoryEntry(const KUrl &url, const QString &title = QString());
     void removeHistoryLocationEntry(int value);
 
-    QList<HistoryItem> find(const QString &text);
+    /**
+     * Finds the history items matching every word of text.
+     * When relevances is not null, it is filled with the relevance
+     * of each returned item. With skipSearchResults, the result
+     * pages of the favorite search engines are left out.
+     */
+    QList<HistoryItem> find(const QString &text, QList<qreal> *relevances = 0, bool skipSearchResults = false);
+
+    // to be called when the favorite search engines change
+    void updateSearchResults();
 
-    QList<HistoryItem> history() const
+    /**
+     * History is loaded in a worker thread: until it has been loaded
+     * (see historyReady signal) just the pages visited in the meantime are there.
+     */
+    bool isReady() const
+    {
+        return m_loaded;
+    }
+
+    /**
+     * Blocks until history has been loaded.
+     * Use just when history is explicitly needed
+     */
+    void waitUntilReady();
+
+    const HistoryList &history() const
     {
         return m_history;
     };
@@ -148,7 +267,14 @@ Q_SIGNALS:
     void entryAdded(const HistoryItem &item);
     void entryRemoved(const HistoryItem &item);
 
+    /**
+     * A known url has been visited again: its (updated) item
+     * has been moved from row "from" to the top of the history.
+     */
+    void entryMoved(const HistoryItem &item, int from);
+
     void historySaved();
+    void historyReady();
 
 public Q_SLOTS:
     void clear();
@@ -157,15 +283,35 @@ public Q_SLOTS:
 private Q_SLOTS:
     void save();
     void checkForExpired();
+    void compactionFinished();
+    void historyLoaded();
 
 private:
     HistoryManager(QObject *parent = 0);
     void load();
 
+    void addVisit(const HistoryItem &visit);
+    void appendPendingRecords();
+    void logRemoval(const HistoryItem &item);
+
     AutoSaver *m_saveTimer;
     int m_historyLimit;
-    QList<HistoryItem> m_history;
-    QString m_lastSavedUrl;
+    HistoryList m_history;
+
+    bool m_loaded;
+    QFutureWatcher<HistoryLog> m_loadWatcher;
+
+    // urls removed before history was loaded: to be removed from the loaded one, too
+    QStringList m_removedWhileLoading;
+
+    // history log records not yet written
+    QList<QByteArray> m_pendingRecords;
+    int m_deadRecords;
+    int m_compactedDeadRecords;
+    bool m_rewriteNeeded;
+    QFutureWatcher<bool> m_compactionWatcher;
+
+    HistoryIndex *m_historyIndex;
 
     HistoryFilterModel *m_historyFilterModel;
     HistoryTreeModel *m_historyTreeModel;
@@ -67,6 +67,7 @@ HistoryModel::HistoryModel(HistoryManager *history, QObject *parent)
     connect(m_historyManager, SIGNAL(historyReset()), this, SLOT(historyReset()));
     connect(m_historyManager, SIGNAL(entryRemoved(HistoryItem)), this, SLOT(historyReset()));
     connect(m_historyManager, SIGNAL(entryAdded(HistoryItem)), this, SLOT(entryAdded()));
+    connect(m_historyManager, SIGNAL(entryMoved(HistoryItem,int)), this, SLOT(entryMoved(HistoryItem,int)));
 }
 
 
@@ -83,6 +84,21 @@ void HistoryModel::entryAdded()
 }
 
 
+void HistoryModel::entryMoved(const HistoryItem &item, int from)
+{
+    Q_UNUSED(item);
+
+    // NOTE: an entry already on top is just updated
+    if (from > 0)
+    {
+        beginMoveRows(QModelIndex(), from, from, QModelIndex(), 0);
+        endMoveRows();
+    }
+
+    emit dataChanged(index(0, 0), index(0, columnCount() - 1));
+}
+
+
 QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
     if (orientation == Qt::Horizontal
@@ -100,11 +116,11 @@ QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int
 
 QVariant HistoryModel::data(const QModelIndex &index, int role) const
 {
-    QList<HistoryItem> lst = m_historyManager->history();
-    if (index.row() < 0 || index.row() >= lst.size())
+    const HistoryList &history = m_historyManager->history();
+    if (index.row() < 0 || index.row() >= history.count())
         return QVariant();
 
-    const HistoryItem &item = lst.at(index.row());
+    const HistoryItem &item = history.at(index.row());
     switch (role)
     {
     case DateTimeRole:
@@ -183,7 +199,7 @@ bool HistoryModel::removeRows(int row, int count, const QModelIndex &parent)
         return false;
     int lastRow = row + count - 1;
     beginRemoveRows(parent, row, lastRow);
-    QList<HistoryItem> lst = m_historyManager->history();
+    QList<HistoryItem> lst = m_historyManager->history().toList();
     for (int i = lastRow; i >= row; --i)
         lst.removeAt(i);
     disconnect(m_historyManager, SIGNAL(historyReset()), this, SLOT(historyReset()));
@@ -199,18 +215,20 @@ bool HistoryModel::removeRows(int row, int count, const QModelIndex &parent)
 
 HistoryFilterModel::HistoryFilterModel(QAbstractItemModel *sourceModel, QObject *parent)
     : QAbstractProxyModel(parent)
-    , m_loaded(false)
 {
     setSourceModel(sourceModel);
 }
 
 
+bool HistoryFilterModel::historyContains(const QString &url) const
+{
+    return HistoryManager::self()->historyContains(url);
+}
+
+
 int HistoryFilterModel::historyLocation(const QString &url) const
 {
-    load();
-    if (!m_historyHash.contains(url))
-        return 0;
-    return sourceModel()->rowCount() - m_historyHash.value(url);
+    return HistoryManager::self()->historyRow(url);
 }
 
 
@@ -226,25 +244,40 @@ void HistoryFilterModel::setSourceModel(QAbstractItemModel *newSourceModel)
     {
         disconnect(sourceModel(), SIGNAL(modelReset()), this, SLOT(sourceReset()));
         disconnect(sourceModel(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
-                   this, SLOT(dataChanged(QModelIndex,QModelIndex)));
+                   this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
+        disconnect(sourceModel(), SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)),
+                   this, SLOT(sourceRowsAboutToBeInserted(QModelIndex,int,int)));
         disconnect(sourceModel(), SIGNAL(rowsInserted(QModelIndex,int,int)),
                    this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
+        disconnect(sourceModel(), SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+                   this, SLOT(sourceRowsAboutToBeRemoved(QModelIndex,int,int)));
         disconnect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
                    this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
+        disconnect(sourceModel(), SIGNAL(rowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+                   this, SLOT(sourceRowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)));
+        disconnect(sourceModel(), SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                   this, SLOT(sourceRowsMoved(QModelIndex,int,int,QModelIndex,int)));
     }
 
     QAbstractProxyModel::setSourceModel(newSourceModel);
 
     if (sourceModel())
     {
-        m_loaded = false;
         connect(sourceModel(), SIGNAL(modelReset()), this, SLOT(sourceReset()));
         connect(sourceModel(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
                 this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
+        connect(sourceModel(), SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)),
+                this, SLOT(sourceRowsAboutToBeInserted(QModelIndex,int,int)));
         connect(sourceModel(), SIGNAL(rowsInserted(QModelIndex,int,int)),
                 this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
+        connect(sourceModel(), SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+                this, SLOT(sourceRowsAboutToBeRemoved(QModelIndex,int,int)));
         connect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
                 this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
+        connect(sourceModel(), SIGNAL(rowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+                this, SLOT(sourceRowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)));
+        connect(sourceModel(), SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                this, SLOT(sourceRowsMoved(QModelIndex,int,int,QModelIndex,int)));
     }
 }
 
@@ -263,17 +296,15 @@ QVariant HistoryFilterModel::headerData(int section, Qt::Orientation orientation
 
 void HistoryFilterModel::sourceReset()
 {
-    m_loaded = false;
     reset();
 }
 
 
 int HistoryFilterModel::rowCount(const QModelIndex &parent) const
 {
-    load();
     if (parent.isValid())
         return 0;
-    return m_historyHash.count();
+    return sourceModel()->rowCount();
 }
 
 
@@ -285,49 +316,27 @@ int HistoryFilterModel::columnCount(const QModelIndex &parent) const
 
 QModelIndex HistoryFilterModel::mapToSource(const QModelIndex &proxyIndex) const
 {
-    load();
-    int sourceRow = sourceModel()->rowCount() - proxyIndex.internalId();
-    return sourceModel()->index(sourceRow, proxyIndex.column());
+    if (!proxyIndex.isValid())
+        return QModelIndex();
+    return sourceModel()->index(proxyIndex.row(), proxyIndex.column());
 }
 
 
 QModelIndex HistoryFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
 {
-    load();
-    QString url = sourceIndex.data(HistoryModel::UrlStringRole).toString();
-    if (!m_historyHash.contains(url))
-        return QModelIndex();
-
-    // This can be done in a binary search, but we can't use qBinary find
-    // because it can't take: qBinaryFind(m_sourceRow.end(), m_sourceRow.begin(), v);
-    // so if this is a performance bottlneck then convert to binary search, until then
-    // the cleaner/easier to read code wins the day.
-    int realRow = -1;
-    int sourceModelRow = sourceModel()->rowCount() - sourceIndex.row();
-
-    for (int i = 0; i < m_sourceRow.count(); ++i)
-    {
-        if (m_sourceRow.at(i) == sourceModelRow)
-        {
-            realRow = i;
-            break;
-        }
-    }
-    if (realRow == -1)
+    if (!sourceIndex.isValid())
         return QModelIndex();
-
-    return createIndex(realRow, sourceIndex.column(), sourceModel()->rowCount() - sourceIndex.row());
+    return createIndex(sourceIndex.row(), sourceIndex.column());
 }
 
 
 QModelIndex HistoryFilterModel::index(int row, int column, const QModelIndex &parent) const
 {
-    load();
     if (row < 0 || row >= rowCount(parent)
             || column < 0 || column >= columnCount(parent))
         return QModelIndex();
 
-    return createIndex(row, column, m_sourceRow[row]);
+    return createIndex(row, column);
 }
 
 
@@ -337,89 +346,47 @@ QModelIndex HistoryFilterModel::parent(const QModelIndex &) const
 }
 
 
-void HistoryFilterModel::load() const
+void HistoryFilterModel::sourceRowsAboutToBeInserted(const QModelIndex &, int start, int end)
 {
-    if (m_loaded)
-        return;
-    m_sourceRow.clear();
-    m_historyHash.clear();
-    m_historyHash.reserve(sourceModel()->rowCount());
-    for (int i = 0; i < sourceModel()->rowCount(); ++i)
-    {
-        QModelIndex idx = sourceModel()->index(i, 0);
-        QString url = idx.data(HistoryModel::UrlStringRole).toString();
-        if (!m_historyHash.contains(url))
-        {
-            m_sourceRow.append(sourceModel()->rowCount() - i);
-            m_historyHash[url] = sourceModel()->rowCount() - i;
-        }
-    }
-    m_loaded = true;
+    beginInsertRows(QModelIndex(), start, end);
 }
 
 
-void HistoryFilterModel::sourceRowsInserted(const QModelIndex &parent, int start, int end)
+void HistoryFilterModel::sourceRowsInserted(const QModelIndex &, int, int)
 {
-    Q_UNUSED(end);
+    endInsertRows();
+}
 
-    if (start != 0)
-    {
-        kDebug() << "STARTING from a NON zero position...";
-        return;
-    }
 
-    if (!m_loaded)
-        return;
+void HistoryFilterModel::sourceRowsAboutToBeRemoved(const QModelIndex &, int start, int end)
+{
+    beginRemoveRows(QModelIndex(), start, end);
+}
 
-    QModelIndex idx = sourceModel()->index(start, 0, parent);
-    QString url = idx.data(HistoryModel::UrlStringRole).toString();
-    if (m_historyHash.contains(url))
-    {
-        int sourceRow = sourceModel()->rowCount() - m_historyHash[url];
-        int realRow = mapFromSource(sourceModel()->index(sourceRow, 0)).row();
-        beginRemoveRows(QModelIndex(), realRow, realRow);
-        m_sourceRow.removeAt(realRow);
-        m_historyHash.remove(url);
-        endRemoveRows();
-    }
-    beginInsertRows(QModelIndex(), 0, 0);
-    m_historyHash.insert(url, sourceModel()->rowCount() - start);
-    m_sourceRow.insert(0, sourceModel()->rowCount());
-    endInsertRows();
+
+void HistoryFilterModel::sourceRowsRemoved(const QModelIndex &, int, int)
+{
+    endRemoveRows();
 }
 
 
-void HistoryFilterModel::sourceRowsRemoved(const QModelIndex &, int start, int end)
+void HistoryFilterModel::sourceRowsAboutToBeMoved(const QModelIndex &, int start, int end, const QModelIndex &, int row)
 {
-    Q_UNUSED(start);
-    Q_UNUSED(end);
-    sourceReset();
+    beginMoveRows(QModelIndex(), start, end, QModelIndex(), row);
+}
+
+
+void HistoryFilterModel::sourceRowsMoved(const QModelIndex &, int, int, const QModelIndex &, int)
+{
+    endMoveRows();
 }
 
 
-/*
-    Removing a continuous block of rows will remove filtered rows too as this is
-    the users intention.
-*/
 bool HistoryFilterModel::removeRows(int row, int count, const QModelIndex &parent)
 {
     if (row < 0 || count <= 0 || row + count > rowCount(parent) || parent.isValid())
         return false;
-    int lastRow = row + count - 1;
-    disconnect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
-               this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
-    beginRemoveRows(parent, row, lastRow);
-    int oldCount = rowCount();
-    int start = sourceModel()->rowCount() - m_sourceRow.value(row);
-    int end = sourceModel()->rowCount() - m_sourceRow.value(lastRow);
-    sourceModel()->removeRows(start, end - start + 1);
-    endRemoveRows();
-    connect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
-            this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
-    m_loaded = false;
-    if (oldCount - count != rowCount())
-        reset();
-    return true;
+    return sourceModel()->removeRows(row, count);
 }
 
 
@@ -626,10 +593,14 @@ void HistoryTreeModel::setSourceModel(QAbstractItemModel *newSourceModel)
     {
         disconnect(sourceModel(), SIGNAL(modelReset()), this, SLOT(sourceReset()));
         disconnect(sourceModel(), SIGNAL(layoutChanged()), this, SLOT(sourceReset()));
+        disconnect(sourceModel(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                   this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
         disconnect(sourceModel(), SIGNAL(rowsInserted(QModelIndex,int,int)),
                    this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
         disconnect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
                    this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
+        disconnect(sourceModel(), SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                   this, SLOT(sourceRowsMoved(QModelIndex,int,int,QModelIndex,int)));
     }
 
     QAbstractProxyModel::setSourceModel(newSourceModel);
@@ -638,10 +609,14 @@ void HistoryTreeModel::setSourceModel(QAbstractItemModel *newSourceModel)
     {
         connect(sourceModel(), SIGNAL(modelReset()), this, SLOT(sourceReset()));
         connect(sourceModel(), SIGNAL(layoutChanged()), this, SLOT(sourceReset()));
+        connect(sourceModel(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
         connect(sourceModel(), SIGNAL(rowsInserted(QModelIndex,int,int)),
                 this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
         connect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
                 this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
+        connect(sourceModel(), SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                this, SLOT(sourceRowsMoved(QModelIndex,int,int,QModelIndex,int)));
     }
 
     reset();
@@ -655,6 +630,29 @@ void HistoryTreeModel::sourceReset()
 }
 
 
+void HistoryTreeModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    // NOTE: the top entry has been visited again, on a new day: it does not belong
+    // to the date of the entries below anymore. Take it out and put it back on top
+    if (topLeft.row() == 0 && !m_sourceRowCache.isEmpty() && rowCount(index(0, 0)) > 1)
+    {
+        QDate date = sourceModel()->index(0, 0).data(HistoryModel::DateRole).toDate();
+        if (sourceModel()->index(1, 0).data(HistoryModel::DateRole).toDate() != date)
+        {
+            sourceRowsRemoved(QModelIndex(), 0, 0);
+            sourceRowsInserted(QModelIndex(), 0, 0);
+            return;
+        }
+    }
+
+    emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight));
+
+    // the first date is the one of the top entry
+    if (topLeft.row() == 0)
+        emit dataChanged(index(0, 0), index(0, columnCount(QModelIndex()) - 1));
+}
+
+
 void HistoryTreeModel::sourceRowsInserted(const QModelIndex &parent, int start, int end)
 {
     Q_UNUSED(parent); // Avoid warnings when compiling release
@@ -666,17 +664,41 @@ void HistoryTreeModel::sourceRowsInserted(const QModelIndex &parent, int start,
         return;
     }
 
-    m_sourceRowCache.clear();
-    QModelIndex treeIndex = mapFromSource(sourceModel()->index(start, 0));
-    QModelIndex treeParent = treeIndex.parent();
-    if (rowCount(treeParent) == 1)
+    if (m_sourceRowCache.isEmpty())
+    {
+        QModelIndex treeIndex = mapFromSource(sourceModel()->index(start, 0));
+        QModelIndex treeParent = treeIndex.parent();
+        if (rowCount(treeParent) == 1)
+        {
+            beginInsertRows(QModelIndex(), 0, 0);
+            endInsertRows();
+        }
+        else
+        {
+            beginInsertRows(treeParent, treeIndex.row(), treeIndex.row());
+            endInsertRows();
+        }
+        return;
+    }
+
+    // NOTE: the new row is the first one: it belongs to the first date
+    // or starts a new one. Just shift the date offsets, no need to rescan
+    QDate date = sourceModel()->index(0, 0).data(HistoryModel::DateRole).toDate();
+    bool newDate = sourceModel()->rowCount() == 1
+                   || sourceModel()->index(1, 0).data(HistoryModel::DateRole).toDate() != date;
+    if (newDate)
     {
         beginInsertRows(QModelIndex(), 0, 0);
+        for (int j = 0; j < m_sourceRowCache.count(); ++j)
+            ++m_sourceRowCache[j];
+        m_sourceRowCache.prepend(0);
         endInsertRows();
     }
     else
     {
-        beginInsertRows(treeParent, treeIndex.row(), treeIndex.row());
+        beginInsertRows(index(0, 0), 0, 0);
+        for (int j = 1; j < m_sourceRowCache.count(); ++j)
+            ++m_sourceRowCache[j];
         endInsertRows();
     }
 }
@@ -745,6 +767,23 @@ void HistoryTreeModel::sourceRowsRemoved(const QModelIndex &parent, int start, i
 }
 
 
+void HistoryTreeModel::sourceRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row)
+{
+    Q_UNUSED(destination);
+
+    if (start != end || row != 0)
+    {
+        sourceReset();
+        return;
+    }
+
+    // NOTE: a revisited entry moved on top: take it out of its date
+    // and put it back in the first one. Both steps update the cache in place
+    sourceRowsRemoved(parent, start, end);
+    sourceRowsInserted(parent, 0, 0);
+}
+
+
 // ----------------------------------------------------------------------------------------------------------
 
 
@@ -43,6 +43,7 @@
 #include <QSortFilterProxyModel>
 
 // Forward Declarations
+class HistoryItem;
 class HistoryManager;
 
 
@@ -65,6 +66,7 @@ public:
 public Q_SLOTS:
     void historyReset();
     void entryAdded();
+    void entryMoved(const HistoryItem &item, int from);
 
 public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
@@ -82,9 +84,10 @@ private:
 
 
 /**
- * Proxy model that will remove any duplicate entries.
- * Both m_sourceRow and m_historyHash store their offsets not from
- * the front of the list, but as offsets from the back.
+ * Proxy model of the history, one row per url.
+ * The history manager already keeps one entry per url (a revisited one
+ * is moved on top), so rows map one to one and source changes are just
+ * forwarded, moves included: nothing is rebuilt on a visit.
  *
  */
 class HistoryFilterModel : public QAbstractProxyModel
@@ -94,18 +97,7 @@ class HistoryFilterModel : public QAbstractProxyModel
 public:
     explicit HistoryFilterModel(QAbstractItemModel *sourceModel, QObject *parent = 0);
 
-    inline bool historyContains(const QString &url) const
-    {
-        load();
-        return m_historyHash.contains(url);
-    }
-
-    inline QList<QString> keys() const
-    {
-        load();
-        return m_historyHash.keys();
-    }
-
+    bool historyContains(const QString &url) const;
     int historyLocation(const QString &url) const;
 
     QModelIndex mapFromSource(const QModelIndex &sourceIndex) const;
@@ -122,15 +114,12 @@ public:
 private Q_SLOTS:
     void sourceReset();
     void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
-    void sourceRowsInserted(const QModelIndex &parent, int start, int end);
+    void sourceRowsAboutToBeInserted(const QModelIndex &, int, int);
+    void sourceRowsInserted(const QModelIndex &, int, int);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &, int, int);
     void sourceRowsRemoved(const QModelIndex &, int, int);
-
-private:
-    void load() const;
-
-    mutable QList<int> m_sourceRow;
-    mutable QHash<QString, int> m_historyHash;
-    mutable bool m_loaded;
+    void sourceRowsAboutToBeMoved(const QModelIndex &, int, int, const QModelIndex &, int);
+    void sourceRowsMoved(const QModelIndex &, int, int, const QModelIndex &, int);
 };
 
 
@@ -168,8 +157,10 @@ public:
 
 private Q_SLOTS:
     void sourceReset();
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
     void sourceRowsInserted(const QModelIndex &parent, int start, int end);
     void sourceRowsRemoved(const QModelIndex &parent, int start, int end);
+    void sourceRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row);
 
 private:
     int sourceDateRow(int row) const;
@@ -0,0 +1,197 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "historyindex.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QDateTime>
+#include <QtTest>
+
+
+static HistoryItem historyItem(const QString &url, const QString &title, int daysAgo = 0)
+{
+    return HistoryItem(url, QDateTime::currentDateTime().addDays(-daysAgo), title);
+}
+
+
+static QStringList urls(const QList<HistoryItem> &items)
+{
+    QStringList list;
+    Q_FOREACH(const HistoryItem & item, items)
+    {
+        list << item.url;
+    }
+    list.sort();
+    return list;
+}
+
+
+class HistoryIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+
+    void find_data();
+    void find();
+
+    void refine();
+    void revisit();
+    void removeItem();
+    void compaction();
+
+private:
+    HistoryIndex m_index;
+};
+
+
+void HistoryIndexTest::init()
+{
+    QList<HistoryItem> list;
+    list << historyItem(QL1S("http://www.kde.org/"), QL1S("KDE - Experience Freedom!"))
+         << historyItem(QL1S("http://rekonq.kde.org/"), QL1S("rekonq, the web browser"), 1)
+         << historyItem(QL1S("http://www.example.com/news/today.html"), QL1S("Today news"), 2)
+         << historyItem(QL1S("http://www.example.com/weather"), QL1S("Weather"), 3);
+
+    m_index.setItems(list);
+}
+
+
+void HistoryIndexTest::find_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("result");
+
+    QTest::newRow("url") << "kde.org"
+                         << (QStringList() << "http://rekonq.kde.org/" << "http://www.kde.org/");
+    QTest::newRow("title") << "browser" << (QStringList() << "http://rekonq.kde.org/");
+    QTest::newRow("case") << "FREEDOM" << (QStringList() << "http://www.kde.org/");
+    QTest::newRow("words") << "example news"
+                           << (QStringList() << "http://www.example.com/news/today.html");
+    QTest::newRow("words, in url and title") << "example weather"
+            << (QStringList() << "http://www.example.com/weather");
+    QTest::newRow("short") << "we"
+                           << (QStringList() << "http://rekonq.kde.org/" << "http://www.example.com/weather");
+    QTest::newRow("no match") << "planet" << QStringList();
+}
+
+
+void HistoryIndexTest::find()
+{
+    QFETCH(QString, text);
+    QFETCH(QStringList, result);
+
+    QCOMPARE(urls(m_index.find(text)), result);
+}
+
+
+void HistoryIndexTest::refine()
+{
+    // every char typed narrows the last result
+    QCOMPARE(m_index.find(QL1S("exa")).count(), 2);
+    QCOMPARE(m_index.find(QL1S("exam")).count(), 2);
+    QCOMPARE(urls(m_index.find(QL1S("example.com/w"))), QStringList() << "http://www.example.com/weather");
+
+    // and a new item is found, even if the query did not change
+    m_index.addItem(historyItem(QL1S("http://www.example.com/wiki"), QL1S("Wiki")));
+    QCOMPARE(m_index.find(QL1S("example.com/w")).count(), 2);
+}
+
+
+void HistoryIndexTest::revisit()
+{
+    HistoryItem item = m_index.item(QL1S("http://www.example.com/weather"));
+    item.title = QL1S("Rainy weather");
+    item.visitCount++;
+    m_index.addItem(item);
+
+    QCOMPARE(m_index.count(), 4);
+    QCOMPARE(m_index.item(item.url).title, item.title);
+    QCOMPARE(urls(m_index.find(QL1S("rainy"))), QStringList() << item.url);
+
+    QList<qreal> relevances;
+    m_index.find(QL1S("weather"), &relevances);
+    QCOMPARE(relevances.count(), 1);
+}
+
+
+void HistoryIndexTest::removeItem()
+{
+    const HistoryItem item = m_index.item(QL1S("http://www.kde.org/"));
+    m_index.removeItem(item);
+
+    QCOMPARE(m_index.count(), 3);
+    QVERIFY(!m_index.contains(item.url));
+    QCOMPARE(urls(m_index.find(QL1S("kde"))), QStringList() << "http://rekonq.kde.org/");
+    QVERIFY(m_index.find(QL1S("freedom")).isEmpty());
+
+    // an item is removed just if it is the indexed one
+    m_index.removeItem(historyItem(QL1S("http://rekonq.kde.org/"), QL1S("an older title"), 10));
+    QCOMPARE(m_index.count(), 3);
+}
+
+
+void HistoryIndexTest::compaction()
+{
+    m_index.clear();
+
+    // removed items pile up in the postings, until they are dropped all at once
+    QList<HistoryItem> items;
+    for (int i = 0; i < 100; ++i)
+    {
+        items << historyItem(QL1S("http://www.example.com/page") + QString::number(i), QL1S("Page"));
+        m_index.addItem(items.last());
+    }
+
+    for (int i = 0; i < 90; ++i)
+    {
+        m_index.removeItem(items.at(i));
+        QCOMPARE(m_index.find(QL1S("example page")).count(), 99 - i);
+    }
+
+    QCOMPARE(m_index.count(), 10);
+    QCOMPARE(urls(m_index.find(QL1S("page95"))), QStringList() << "http://www.example.com/page95");
+
+    // ...and the index keeps on working
+    m_index.addItem(items.first());
+    QCOMPARE(m_index.find(QL1S("example page")).count(), 11);
+    QCOMPARE(urls(m_index.find(QL1S("page0"))), QStringList() << "http://www.example.com/page0");
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(HistoryIndexTest, NoGUI)
+#include "historyindextest.moc"
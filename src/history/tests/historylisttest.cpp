@@ -0,0 +1,223 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "historymanager.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QDateTime>
+#include <QtTest>
+
+
+static HistoryItem historyItem(int i)
+{
+    return HistoryItem(QL1S("http://www.example.com/") + QString::number(i),
+                       QDateTime::currentDateTime(), QString::number(i));
+}
+
+
+class HistoryListTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void prepend();
+    void moveToTop();
+    void take();
+    void setItems();
+    void randomOperations();
+
+private:
+    void compare(const HistoryList &history, const QList<HistoryItem> &expected);
+};
+
+
+void HistoryListTest::compare(const HistoryList &history, const QList<HistoryItem> &expected)
+{
+    QCOMPARE(history.count(), expected.count());
+    QCOMPARE(history.toList(), expected);
+
+    for (int row = 0; row < expected.count(); ++row)
+    {
+        QCOMPARE(history.at(row), expected.at(row));
+        QCOMPARE(history.row(expected.at(row).url), row);
+    }
+}
+
+
+void HistoryListTest::prepend()
+{
+    HistoryList history;
+    QVERIFY(history.isEmpty());
+    QCOMPARE(history.row(historyItem(0).url), -1);
+
+    QList<HistoryItem> expected;
+    for (int i = 0; i < 20; ++i)
+    {
+        history.prepend(historyItem(i));
+        expected.prepend(historyItem(i));
+        compare(history, expected);
+    }
+
+    QVERIFY(history.contains(historyItem(5).url));
+    QCOMPARE(history.item(historyItem(5).url), historyItem(5));
+    QCOMPARE(history.last(), historyItem(0));
+}
+
+
+void HistoryListTest::moveToTop()
+{
+    HistoryList history;
+    QList<HistoryItem> expected;
+    for (int i = 0; i < 10; ++i)
+    {
+        history.prepend(historyItem(i));
+        expected.prepend(historyItem(i));
+    }
+
+    HistoryItem item = historyItem(3);
+    item.title = QL1S("visited again");
+    item.visitCount = 2;
+
+    const int row = expected.indexOf(historyItem(3));
+    QCOMPARE(history.moveToTop(item), row);
+    expected.removeAt(row);
+    expected.prepend(item);
+    compare(history, expected);
+
+    // the top one stays there
+    QCOMPARE(history.moveToTop(item), 0);
+    compare(history, expected);
+}
+
+
+void HistoryListTest::take()
+{
+    HistoryList history;
+    QList<HistoryItem> expected;
+    for (int i = 0; i < 10; ++i)
+    {
+        history.prepend(historyItem(i));
+        expected.prepend(historyItem(i));
+    }
+
+    QCOMPARE(history.takeAt(4), expected.takeAt(4));
+    compare(history, expected);
+
+    QCOMPARE(history.takeLast(), expected.takeLast());
+    compare(history, expected);
+
+    QVERIFY(!history.contains(historyItem(0).url));
+
+    while (!expected.isEmpty())
+        QCOMPARE(history.takeAt(0), expected.takeFirst());
+    QVERIFY(history.isEmpty());
+
+    // and it is still usable
+    history.prepend(historyItem(42));
+    compare(history, QList<HistoryItem>() << historyItem(42));
+}
+
+
+void HistoryListTest::setItems()
+{
+    QList<HistoryItem> list;
+    for (int i = 0; i < 10; ++i)
+        list << historyItem(i);
+
+    // an older duplicate is dropped
+    HistoryItem duplicate = historyItem(2);
+    duplicate.title = QL1S("older");
+    list << duplicate;
+
+    HistoryList history;
+    history.setItems(list);
+
+    list.removeLast();
+    compare(history, list);
+
+    history.clear();
+    QVERIFY(history.isEmpty());
+    QVERIFY(!history.contains(historyItem(2).url));
+}
+
+
+void HistoryListTest::randomOperations()
+{
+    // revisits and removals leave dead slots behind, dropped now and then:
+    // the list has to stay the same as a plain one all the way
+    HistoryList history;
+    QList<HistoryItem> expected;
+
+    qsrand(42);
+    int next = 0;
+    for (int step = 0; step < 2000; ++step)
+    {
+        const int operation = qrand() % 4;
+        if (operation == 0 || expected.isEmpty())
+        {
+            history.prepend(historyItem(next));
+            expected.prepend(historyItem(next));
+            next++;
+        }
+        else if (operation == 1)
+        {
+            const int row = qrand() % expected.count();
+            HistoryItem item = expected.takeAt(row);
+            item.visitCount++;
+            QCOMPARE(history.moveToTop(item), row);
+            expected.prepend(item);
+        }
+        else if (operation == 2)
+        {
+            const int row = qrand() % expected.count();
+            QCOMPARE(history.takeAt(row), expected.takeAt(row));
+        }
+        else
+        {
+            const int row = qrand() % expected.count();
+            QCOMPARE(history.at(row), expected.at(row));
+            QCOMPARE(history.row(expected.at(row).url), row);
+        }
+
+        QCOMPARE(history.count(), expected.count());
+    }
+
+    compare(history, expected);
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(HistoryListTest, NoGUI)
+#include "historylisttest.moc"
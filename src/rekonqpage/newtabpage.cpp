@@ -39,6 +39,7 @@
 
 #include "previewselectorbar.h"
 #include "thumbupdater.h"
+#include "thumbnailstore.h"
 #include "websnap.h"
 #include "webpage.h"
 #include "webtab.h"
@@ -431,6 +432,18 @@ void NewTabPage::historyPage(const QString & filter)
     clearHistory.setAttribute(QL1S("class"), QL1S("right"));
     m_root.document().findFirst(QL1S("#actions")).appendInside(clearHistory);
 
+    // NOTE: history is loaded in a worker thread at startup.
+    // Until it is there, just say it: the page is built again when it is ready
+    if (!HistoryManager::self()->isReady())
+    {
+        m_pendingHistoryFilter = filter;
+        connect(HistoryManager::self(), SIGNAL(historyReady()), this, SLOT(historyReady()), Qt::UniqueConnection);
+
+        m_root.addClass(QL1S("empty"));
+        m_root.setPlainText(i18n("Loading history..."));
+        return;
+    }
+
     HistoryTreeModel *model = HistoryManager::self()->historyTreeModel();
     SortFilterProxyModel *proxy = new SortFilterProxyModel(this);
     proxy->setSourceModel(model);
@@ -522,6 +535,18 @@ void NewTabPage::historyPage(const QString & filter)
 }
 
 
+void NewTabPage::historyReady()
+{
+    disconnect(HistoryManager::self(), SIGNAL(historyReady()), this, SLOT(historyReady()));
+
+    // the user could have left the history page in the meantime
+    if (!m_root.hasClass(QL1S("history")))
+        return;
+
+    loadPageForUrl(KUrl("rekonq:history"), m_pendingHistoryFilter);
+}
+
+
 void NewTabPage::bookmarksPage()
 {
     m_root.addClass(QL1S("bookmarks"));
@@ -796,8 +821,9 @@ QWebElement NewTabPage::validPreview(int index, const KUrl &url, const QString &
 {
     QWebElement prev = markup(QL1S(".thumbnail"));
 
-    QString previewPath = WebSnap::existsImage(url)
-                          ? QL1S("file://") + WebSnap::imagePathFromUrl(url)
+    const QString thumbnail = ThumbnailStore::self()->existingThumbnail(url);
+    QString previewPath = !thumbnail.isEmpty()
+                          ? QL1S("file://") + thumbnail
                           : IconManager::self()->iconPathForUrl(url)
                           ;
 
@@ -836,8 +862,9 @@ QWebElement NewTabPage::closedTabPreview(int index, const KUrl &url, const QStri
 {
     QWebElement prev = markup(QL1S(".thumbnail"));
 
-    QString previewPath = WebSnap::existsImage(url)
-                          ? QL1S("file://") + WebSnap::imagePathFromUrl(url)
+    const QString thumbnail = ThumbnailStore::self()->existingThumbnail(url);
+    QString previewPath = !thumbnail.isEmpty()
+                          ? QL1S("file://") + thumbnail
                           : IconManager::self()->iconPathForUrl(url)
                           ;
 
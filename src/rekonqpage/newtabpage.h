@@ -58,6 +58,10 @@ public:
      */
     void generate(const KUrl &url = KUrl("rekonq:home"));
 
+private Q_SLOTS:
+    // history was not there yet when its page was asked
+    void historyReady();
+
 private:
     // these are the "high-level" functions to build the new tab page.
     // Basically, you call browsingMenu + one of the *Page methods
@@ -120,6 +124,7 @@ private:
     QWebElement m_root;
 
     bool m_showFullHistory;
+    QString m_pendingHistoryFilter;
 };
 
 #endif // REKONQ_NEW_TAB_PAGE
@@ -34,6 +34,18 @@
 #include <KUriFilter>
 
 #include <QStringList>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+
+// a node of the web shortcuts trie: the path from the root spells "key" + delimiter
+struct KeywordNode
+{
+    KeywordNode() : provider(-1) {}
+    QHash<QChar, int> children;
+    int provider;   // first provider with this shortcut, -1 if none
+};
 
 
 struct SearchEnginePrivate
@@ -45,6 +57,9 @@ struct SearchEnginePrivate
     QString delimiter;
     KService::List favorites;
     KService::Ptr defaultEngine;
+    KService::List providers;
+    QVector<KeywordNode> keywords;
+    QList< QPair<QString, QString> > resultPatterns;  // favorites queries, around the searched text
 };
 
 
@@ -79,12 +94,55 @@ void SearchEngine::reload()
     }
     d->favorites = favorites;
 
+    // their result pages: the query url, with the searched text in the middle
+    d->resultPatterns.clear();
+    Q_FOREACH(const KService::Ptr & s, favorites)
+    {
+        const QString query = s->property("Query").toString();
+        const int pos = query.indexOf(QL1S("\\{@}"));
+        if (pos == -1)
+            continue;
+
+        d->resultPatterns << qMakePair(query.left(pos), query.mid(pos + 4));
+    }
+
     // load default engine
     QString dse;
     dse = cg.readEntry("DefaultWebShortcut");
 
     d->defaultEngine = KService::serviceByDesktopPath(QString("searchproviders/%1.desktop").arg(dse));
 
+    // load providers && their shortcuts, just once
+    d->providers = (d->usePreferredOnly)
+        ? d->favorites
+        : KServiceTypeTrader::self()->query("SearchProvider");
+
+    d->keywords.clear();
+    d->keywords.append(KeywordNode());
+    for (int i = 0; i < d->providers.size(); ++i)
+    {
+        QStringList list = d->providers.at(i)->property("Keys").toStringList();
+        Q_FOREACH(const QString & key, list)
+        {
+            const QString searchPrefix = key + d->delimiter;
+            int node = 0;
+            Q_FOREACH(const QChar & c, searchPrefix)
+            {
+                int next = d->keywords.at(node).children.value(c, -1);
+                if (next == -1)
+                {
+                    next = d->keywords.size();
+                    d->keywords.append(KeywordNode());
+                    d->keywords[node].children.insert(c, next);
+                }
+                node = next;
+            }
+
+            if (d->keywords.at(node).provider == -1)
+                d->keywords[node].provider = i;
+        }
+    }
+
     d->isLoaded = true;
 }
 
@@ -120,33 +178,61 @@ KService::Ptr SearchEngine::fromString(const QString &text)
 {
     KService::Ptr service;
 
+    if (!d->isLoaded)
+        reload();
+
     // first, the easy part...
     if (!d->isEnabled)
         return service;
 
-    KService::List providers = (d->usePreferredOnly)
-        ? SearchEngine::favorites()
-        : KServiceTypeTrader::self()->query("SearchProvider");
+    // walk the shortcuts trie along the text: every node with a provider
+    // is a "key:" prefix of it. As before, the first provider wins
+    int best = -1;
+    int node = 0;
+    for (int i = 0; i < text.length(); ++i)
+    {
+        node = d->keywords.at(node).children.value(text.at(i), -1);
+        if (node == -1)
+            break;
+
+        const int provider = d->keywords.at(node).provider;
+        if (provider != -1 && (best == -1 || provider < best))
+            best = provider;
+    }
+
+    if (best != -1)
+        service = d->providers.at(best);
 
-    int i = 0;
-    bool found = false;
-    while (!found && i < providers.size())
+    return service;
+}
+
+
+bool SearchEngine::isSearchResultUrl(const QString &url)
+{
+    if (!d->isLoaded)
+        reload();
+
+    typedef QPair<QString, QString> Pattern;
+    Q_FOREACH(const Pattern & pattern, d->resultPatterns)
     {
-        QStringList list = providers.at(i)->property("Keys").toStringList();
-        Q_FOREACH(const QString & key, list)
+        const int pos = url.indexOf(pattern.first);
+        if (pos == -1)
+            continue;
+
+        // something searched, then the rest of the query
+        const int textPos = pos + pattern.first.length();
+        if (pattern.second.isEmpty())
         {
-            const QString searchPrefix = key + delimiter();
-            if (text.startsWith(searchPrefix))
-            {
-                service = providers.at(i);
-                found = true;
-                break;
-            }
+            if (url.length() > textPos)
+                return true;
+        }
+        else if (url.indexOf(pattern.second, textPos + 1) != -1)
+        {
+            return true;
         }
-        i++;
     }
 
-    return service;
+    return false;
 }
 
 
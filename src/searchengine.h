@@ -55,6 +55,9 @@ QString buildQuery(KService::Ptr engine, const QString &text);
 
 QString extractQuery(const QString &text);
 
+// is url the result page of a search on one of the favorite engines?
+bool isSearchResultUrl(const QString &url);
+
 }
 
 #endif
@@ -30,13 +30,18 @@
 #include "sessionmanager.h"
 #include "sessionmanager.moc"
 
+// Auto Includes
+#include "rekonq.h"
+
 // Local Includes
 #include "application.h"
+#include "autosaver.h"
 #include "tabhistory.h"
 #include "sessionwidget.h"
 
 #include "rekonqwindow.h"
 #include "tabbar.h"
+#include "tabplaceholder.h"
 
 #include "webwindow.h"
 #include "webpage.h"
@@ -44,17 +49,76 @@
 // KDE Includes
 #include <KDialog>
 #include <KPushButton>
+#include <KSaveFile>
 #include <KStandardDirs>
 #include <KUrl>
 
 // Qt Includes
+#include <QDataStream>
 #include <QFile>
-#include <QDomDocument>
 #include <QPointer>
+#include <QWebHistory>
+#include <QXmlStreamReader>
+
+#include <QtConcurrentRun>
+
+
+// The session file: a small index of windows && tabs, followed by the tab histories
+static const quint32 SESSION_FILE_MAGIC = 0x524b5353;   // "RKSS"
+static const quint32 SESSION_FILE_VERSION = 1;
+
+static const quint8 SESSION_TAB_CURRENT = 0x1;
+static const quint8 SESSION_TAB_PINNED = 0x2;
 
 
 // Only used internally
-bool readSessionDocument(QDomDocument & document, const QString & sessionFilePath)
+// NOTE: sessions saved by older rekonq versions are XML: just read them
+static bool readXmlSessionFile(QList<SessionWindow> &session, QFile &sessionFile)
+{
+    QList<SessionWindow> windows;
+    QXmlStreamReader xml(&sessionFile);
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+        if (!xml.isStartElement())
+            continue;
+
+        if (xml.name() == QL1S("window"))
+        {
+            SessionWindow window;
+            window.name = xml.attributes().value(QL1S("name")).toString();
+            windows << window;
+        }
+        else if (xml.name() == QL1S("tab") && !windows.isEmpty())
+        {
+            const QXmlStreamAttributes attributes = xml.attributes();
+
+            SessionTab tab;
+            tab.history.title = attributes.value(QL1S("title")).toString();
+            tab.history.url = attributes.value(QL1S("url")).toString();
+            tab.isCurrent = attributes.hasAttribute(QL1S("currentTab"));
+            tab.isPinned = attributes.hasAttribute(QL1S("pinned"));
+            tab.history.history = QByteArray::fromBase64(xml.readElementText().toAscii());
+
+            windows.last().tabs << tab;
+        }
+    }
+
+    if (xml.hasError())
+    {
+        kDebug() << "Unable to parse session file" << sessionFile.fileName() << xml.errorString();
+        return false;
+    }
+
+    session = windows;
+    return true;
+}
+
+
+// Only used internally
+// NOTE: with withHistory == false, just the index is read: no tab history is loaded
+static bool readSessionFile(QList<SessionWindow> &session, const QString &sessionFilePath,
+                            bool withHistory = true, quint32 *journalSerial = 0)
 {
     QFile sessionFile(sessionFilePath);
 
@@ -67,53 +131,107 @@ bool readSessionDocument(QDomDocument & document, const QString & sessionFilePat
         return false;
     }
 
-    if (!document.setContent(&sessionFile, false))
+    if (journalSerial)
+        *journalSerial = 0;
+
+    QDataStream in(&sessionFile);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic = 0;
+    in >> magic;
+    if (magic != SESSION_FILE_MAGIC)
+    {
+        sessionFile.reset();
+        return readXmlSessionFile(session, sessionFile);
+    }
+
+    quint32 version = 0;
+    quint32 serial = 0;
+    in >> version >> serial;
+    if (version > SESSION_FILE_VERSION)
+    {
+        kDebug() << "Unknown session file version" << version << sessionFile.fileName();
+        return false;
+    }
+
+    QList<SessionWindow> windows;
+    qint32 windowCount = 0;
+    in >> windowCount;
+    for (int winNo = 0; winNo < windowCount && in.status() == QDataStream::Ok; winNo++)
+    {
+        SessionWindow window;
+        qint32 tabCount = 0;
+        in >> window.name >> tabCount;
+        for (int tabNo = 0; tabNo < tabCount && in.status() == QDataStream::Ok; tabNo++)
+        {
+            SessionTab tab;
+            quint8 flags = 0;
+            in >> tab.history.title >> tab.history.url >> flags;
+            tab.isCurrent = (flags & SESSION_TAB_CURRENT);
+            tab.isPinned = (flags & SESSION_TAB_PINNED);
+            window.tabs << tab;
+        }
+        windows << window;
+    }
+
+    if (withHistory)
+    {
+        for (int winNo = 0; winNo < windows.count(); winNo++)
+        {
+            QList<SessionTab> &tabs = windows[winNo].tabs;
+            for (int tabNo = 0; tabNo < tabs.count(); tabNo++)
+                in >> tabs[tabNo].history.history;
+        }
+    }
+
+    if (in.status() != QDataStream::Ok)
     {
         kDebug() << "Unable to parse session file" << sessionFile.fileName();
         return false;
     }
 
+    session = windows;
+    if (journalSerial)
+        *journalSerial = serial;
     return true;
 }
 
 
-int loadTabs(RekonqWindow *tw, QDomElement & window, bool useFirstTab, bool justThePinnedOnes = false)
+int loadTabs(RekonqWindow *tw, const SessionWindow &window, bool useFirstTab, bool justThePinnedOnes = false)
 {
     int currentTab = 0;
 
-    for (unsigned int tabNo = 0; tabNo < window.elementsByTagName("tab").length(); tabNo++)
+    for (int tabNo = 0; tabNo < window.tabs.count(); tabNo++)
     {
-        QDomElement tab = window.elementsByTagName("tab").at(tabNo).toElement();
-        bool tabIsPinned = tab.hasAttribute("pinned");
-        kDebug() << "Tab #" << tabNo <<  " is pinned? " << tabIsPinned;
+        const SessionTab &tab = window.tabs.at(tabNo);
+        kDebug() << "Tab #" << tabNo <<  " is pinned? " << tab.isPinned;
 
-        if (!justThePinnedOnes || tabIsPinned)
+        if (!justThePinnedOnes || tab.isPinned)
         {
-            if (tab.hasAttribute("currentTab"))
-                currentTab = tabNo;
-
-            KUrl u = KUrl(tab.attribute("url"));
-
-            TabHistory tabHistory;
-            tabHistory.title = tab.attribute("title");
-            tabHistory.url = tab.attribute("url");
-            QDomCDATASection historySection = tab.firstChild().toCDATASection();
-            tabHistory.history = QByteArray::fromBase64(historySection.data().toAscii());
+            TabHistory tabHistory = tab.history;
 
+            // NOTE: tabs are restored as placeholders, loaded when activated
+            int index;
             if (tabNo == 0 && useFirstTab)
             {
-                tw->loadUrl(u, Rekonq::CurrentTab, &tabHistory);
+                tw->loadUrl(KUrl(tabHistory.url), Rekonq::CurrentTab, &tabHistory);
+                index = tw->tabWidget()->currentIndex();
             }
             else
             {
-                tw->loadUrl(u, Rekonq::NewTab, &tabHistory);
+                index = tw->tabWidget()->addPlaceholderTab(tabHistory);
             }
 
-            if (tabIsPinned)
+            if (tab.isCurrent)
+                currentTab = index;
+
+            if (tab.isPinned)
             {
-                tw->tabBar()->setTabData(tabNo, true);
-                if (tw->tabBar()->tabButton(tabNo, QTabBar::RightSide))
-                    tw->tabBar()->tabButton(tabNo, QTabBar::RightSide)->hide(); // NOTE: this is not good here: where is its proper place?
+                tw->tabBar()->setTabData(index, true);
+                if (tw->tabBar()->tabButton(index, QTabBar::RightSide))
+                    tw->tabBar()->tabButton(index, QTabBar::RightSide)->hide(); // NOTE: this is not good here: where is its proper place?
+                if (tw->tabWidget()->placeholder(index))
+                    tw->tabWidget()->setTabText(index, QString());
             }
         }
     }
@@ -122,19 +240,65 @@ int loadTabs(RekonqWindow *tw, QDomElement & window, bool useFirstTab, bool just
 }
 
 
-bool areTherePinnedTabs(QDomElement & window)
+// NOTE: this runs (also) in a worker thread
+static bool writeSessionFile(const QList<SessionWindow> &session, const QString &sessionFilePath, quint32 journalSerial = 0)
 {
-    bool b = false;
+    // write a new file && then rename it: a crash cannot leave a truncated session
+    KSaveFile sessionFile(sessionFilePath);
+    if (!sessionFile.open(QFile::WriteOnly))
+    {
+        kDebug() << "Unable to open session file" << sessionFilePath;
+        return false;
+    }
+
+    QDataStream out(&sessionFile);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    out << SESSION_FILE_MAGIC << SESSION_FILE_VERSION << journalSerial;
 
-    for (unsigned int tabNo = 0; tabNo < window.elementsByTagName("tab").length(); tabNo++)
+    // the index first: sessions can be listed without loading histories
+    out << qint32(session.count());
+    Q_FOREACH(const SessionWindow & w, session)
     {
-        QDomElement tab = window.elementsByTagName("tab").at(tabNo).toElement();
-        b = tab.hasAttribute("pinned");
-        if (b)
+        out << w.name << qint32(w.tabs.count());
+        Q_FOREACH(const SessionTab & t, w.tabs)
+        {
+            quint8 flags = 0;
+            if (t.isCurrent)
+                flags |= SESSION_TAB_CURRENT;
+            if (t.isPinned)
+                flags |= SESSION_TAB_PINNED;
+
+            out << t.history.title << t.history.url << flags;
+        }
+    }
+
+    Q_FOREACH(const SessionWindow & w, session)
+    {
+        Q_FOREACH(const SessionTab & t, w.tabs)
+        {
+            out << t.history.history;
+        }
+    }
+
+    if (!sessionFile.finalize())
+    {
+        kDebug() << "Unable to write session file" << sessionFilePath << sessionFile.errorString();
+        return false;
+    }
+    return true;
+}
+
+
+bool areTherePinnedTabs(const SessionWindow &window)
+{
+    Q_FOREACH(const SessionTab & tab, window.tabs)
+    {
+        if (tab.isPinned)
             return true;
     }
 
-    return b;
+    return false;
 }
 
 
@@ -159,94 +323,302 @@ SessionManager *SessionManager::self()
 
 SessionManager::SessionManager(QObject *parent)
     : QObject(parent)
-    , m_safe(true)
     , m_isSessionEnabled(false)
+    , m_saveTimer(new AutoSaver(this))
+    , m_hasPendingSession(false)
+    , m_isSavedSessionRead(false)
+    , m_hasSavedSession(false)
+    , m_journalSerial(0)
+    , m_pendingJournalSerial(0)
+    , m_writingJournalSerial(0)
 {
     m_sessionFilePath = KStandardDirs::locateLocal("appdata" , "session");
+
+    connect(m_saveTimer, SIGNAL(saveNeeded()), this, SLOT(takeSessionSnapshot()));
+    connect(&m_saveWatcher, SIGNAL(finished()), this, SLOT(sessionWritten()));
+}
+
+
+SessionManager::~SessionManager()
+{
+    // don't lose the last snapshot
+    m_saveWatcher.waitForFinished();
+    if (m_hasPendingSession)
+        writeSessionFile(m_pendingSession, m_sessionFilePath, m_pendingJournalSerial);
 }
 
 
 void SessionManager::saveSession()
 {
-    if (!m_isSessionEnabled || !m_safe)
+    if (!m_isSessionEnabled)
         return;
 
-    m_safe = false;
+    m_saveTimer->changeOccurred();
+}
 
-    kDebug() << "SAVING SESSION...";
 
-    QFile sessionFile(m_sessionFilePath);
-    if (!sessionFile.open(QFile::WriteOnly | QFile::Truncate))
-    {
-        kDebug() << "Unable to open session file" << sessionFile.fileName();
+void SessionManager::saveSessionNow()
+{
+    if (!m_isSessionEnabled)
         return;
-    }
-    RekonqWindowList wl = rApp->rekonqWindowList();
-    QDomDocument document("session");
-    QDomElement session = document.createElement("session");
-    document.appendChild(session);
 
+    m_saveTimer->changeOccurred();
+    m_saveTimer->saveIfNeccessary();
+}
+
+
+QList<SessionWindow> SessionManager::currentSession()
+{
+    QList<SessionWindow> session;
+    HistoryCache historyCache;
+
+    RekonqWindowList wl = rApp->rekonqWindowList();
     Q_FOREACH(const QWeakPointer<RekonqWindow> &w, wl)
     {
         if (w.data()->isPrivateBrowsingMode())
             continue;
-        
-        QDomElement window = document.createElement("window");
-        int tabInserted = 0;
 
-        window.setAttribute("name", w.data()->objectName());
-        
+        SessionWindow window;
+        window.name = w.data()->objectName();
+
         TabWidget *tw = w.data()->tabWidget();
         for (signed int tabNo = 0; tabNo < tw->count(); tabNo++)
         {
-            KUrl u = tw->webWindow(tabNo)->url();
-
-            tabInserted++;
-            QDomElement tab = document.createElement("tab");
-            tab.setAttribute("title", tw->webWindow(tabNo)->title()); // redundant, but needed for closedSites()
-            // as there's not way to read out the historyData
-            tab.setAttribute("url", u.url());
-            if (tw->currentIndex() == tabNo)
+            SessionTab tab;
+            tab.isCurrent = (tw->currentIndex() == tabNo);
+            tab.isPinned = tw->tabBar()->tabData(tabNo).toBool();
+
+            // not loaded tabs have their history ready
+            TabPlaceholder *placeholder = tw->placeholder(tabNo);
+            if (placeholder)
             {
-                tab.setAttribute("currentTab", 1);
+                tab.history = placeholder->history();
+                window.tabs << tab;
+                continue;
             }
-            if (tw->tabBar()->tabData(tabNo).toBool()) // pinned tab info
+
+            WebWindow *webWindow = tw->webWindow(tabNo);
+            QWebHistory *history = webWindow->page()->history();
+
+            tab.history.title = webWindow->title();
+            tab.history.url = webWindow->url().url();
+
+            // serialize the history just when it changed since last time
+            HistoryCacheEntry entry = m_historyCache.value(history);
+            const QWebHistoryItem currentItem = history->currentItem();
+            if (entry.history.isEmpty()
+                    || entry.count != history->count()
+                    || entry.currentIndex != history->currentItemIndex()
+                    || entry.currentUrl != currentItem.url()
+                    || entry.lastVisited != currentItem.lastVisited())
             {
-                tab.setAttribute("pinned", 1);
+                entry.count = history->count();
+                entry.currentIndex = history->currentItemIndex();
+                entry.currentUrl = currentItem.url();
+                entry.lastVisited = currentItem.lastVisited();
+
+                QByteArray data;
+                QDataStream historyStream(&data, QIODevice::WriteOnly);
+                historyStream << *history;
+                entry.history = data;
             }
-            QByteArray history;
-            QDataStream historyStream(&history, QIODevice::ReadWrite);
-            historyStream << *(tw->webWindow(tabNo)->page()->history());
-            QDomCDATASection historySection = document.createCDATASection(history.toBase64());
+            historyCache.insert(history, entry);
 
-            tab.appendChild(historySection);
-            window.appendChild(tab);
+            tab.history.history = entry.history;
+            window.tabs << tab;
         }
-        
-        if (tabInserted > 0)
-            session.appendChild(window);
+
+        if (!window.tabs.isEmpty())
+            session << window;
     }
 
-    QTextStream TextStream(&sessionFile);
-    document.save(TextStream, 2);
-    sessionFile.close();
+    // closed tabs are forgotten here
+    m_historyCache = historyCache;
 
-    m_safe = true;
-    return;
+    return session;
 }
 
 
-bool SessionManager::restoreSessionFromScratch()
+void SessionManager::takeSessionSnapshot()
 {
-    QDomDocument document("session");
+    if (!m_isSessionEnabled)
+        return;
 
-    if (!readSessionDocument(document, m_sessionFilePath))
-        return false;
+    kDebug() << "SAVING SESSION...";
+
+    // just the last snapshot matters: it replaces the one waiting (if any)
+    m_pendingSession = currentSession();
+    m_pendingJournalSerial = m_journalSerial;
+    m_hasPendingSession = true;
+
+    // ... and it is what the session file is going to contain
+    m_savedSession = m_pendingSession;
+    m_isSavedSessionRead = true;
+    m_hasSavedSession = true;
+
+    // a new journal for each run, starting from its first snapshot
+    if (ReKonfig::sessionJournal() && !m_journal.isOpen())
+    {
+        m_journal.setFileName(m_sessionFilePath + QL1S(".journal"));
+        if (!m_journal.open(QFile::WriteOnly | QFile::Truncate))
+            kDebug() << "Unable to open session journal" << m_journal.fileName();
+    }
+
+    if (!m_saveWatcher.isRunning())
+        writePendingSession();
+}
+
+
+void SessionManager::journalTabEvent(TabEvent event, const QString &windowName, int index,
+                                     const QString &url, int value)
+{
+    if (!m_isSessionEnabled || !m_journal.isOpen() || windowName.isEmpty())
+        return;
 
-    for (unsigned int winNo = 0; winNo < document.elementsByTagName("window").length(); winNo++)
+    if (!ReKonfig::sessionJournal())
     {
-        QDomElement window = document.elementsByTagName("window").at(winNo).toElement();
+        m_journal.remove();
+        return;
+    }
+
+    // one write per record: a crash can truncate just the last one
+    m_journal.write(journalRecord(++m_journalSerial, event, windowName, index, url, value));
+    m_journal.flush();
+}
 
+
+QByteArray SessionManager::journalRecord(quint32 serial, TabEvent event, const QString &windowName, int index,
+                                         const QString &url, int value)
+{
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_6);
+    out << serial << quint8(event) << windowName << qint32(index) << url << qint32(value);
+    return record;
+}
+
+
+// Applies to the session the tab events journaled after its snapshot
+void SessionManager::replayJournal(QList<SessionWindow> &session, QIODevice *journal, quint32 snapshotSerial)
+{
+    QDataStream in(journal);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    while (!in.atEnd())
+    {
+        quint32 serial = 0;
+        quint8 event = 0;
+        QString windowName;
+        qint32 index = 0;
+        QString url;
+        qint32 value = 0;
+        in >> serial >> event >> windowName >> index >> url >> value;
+
+        // the last record can have been truncated by a crash
+        if (in.status() != QDataStream::Ok)
+            break;
+
+        if (serial <= snapshotSerial)
+            continue;
+
+        int winNo = 0;
+        while (winNo < session.count() && session.at(winNo).name != windowName)
+            winNo++;
+
+        if (winNo == session.count())
+        {
+            if (event != TabAdded)
+                continue;
+
+            SessionWindow window;
+            window.name = windowName;
+            session << window;
+        }
+
+        QList<SessionTab> &tabs = session[winNo].tabs;
+        const bool isValidIndex = (index >= 0 && index < tabs.count());
+        switch (event)
+        {
+        case TabAdded:
+        {
+            SessionTab tab;
+            tab.history.url = url;
+            tabs.insert(qBound(0, int(index), tabs.count()), tab);
+            break;
+        }
+        case TabClosed:
+            if (isValidIndex)
+                tabs.removeAt(index);
+            break;
+        case TabNavigated:
+            if (isValidIndex)
+            {
+                tabs[index].history.url = url;
+                tabs[index].history.title.clear();
+            }
+            break;
+        case TabMoved:
+            if (isValidIndex && value >= 0 && value < tabs.count())
+                tabs.move(index, value);
+            break;
+        case TabPinned:
+            if (isValidIndex)
+                tabs[index].isPinned = (value != 0);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+
+void SessionManager::writePendingSession()
+{
+    if (!m_hasPendingSession)
+        return;
+
+    m_writingJournalSerial = m_pendingJournalSerial;
+    m_saveWatcher.setFuture(QtConcurrent::run(writeSessionFile, m_pendingSession, m_sessionFilePath, m_writingJournalSerial));
+
+    m_pendingSession.clear();
+    m_hasPendingSession = false;
+}
+
+
+void SessionManager::sessionWritten()
+{
+    if (!m_saveWatcher.result())
+        kDebug() << "Session has not been saved";
+    else if (m_journal.isOpen() && m_writingJournalSerial == m_journalSerial)
+        m_journal.resize(0);    // every journaled event is in the snapshot
+
+    writePendingSession();
+}
+
+
+bool SessionManager::readSavedSession()
+{
+    if (!m_isSavedSessionRead)
+    {
+        quint32 snapshotSerial = 0;
+        m_hasSavedSession = readSessionFile(m_savedSession, m_sessionFilePath, true, &snapshotSerial);
+        QFile journal(m_sessionFilePath + QL1S(".journal"));
+        if (m_hasSavedSession && journal.open(QFile::ReadOnly))
+            replayJournal(m_savedSession, &journal, snapshotSerial);
+        m_isSavedSessionRead = true;
+    }
+
+    return m_hasSavedSession;
+}
+
+
+bool SessionManager::restoreSessionFromScratch()
+{
+    if (!readSavedSession())
+        return false;
+
+    Q_FOREACH(const SessionWindow & window, m_savedSession)
+    {
         RekonqWindow *tw = rApp->newWindow();
 
         int currentTab = loadTabs(tw, window, true, false);
@@ -260,16 +632,12 @@ bool SessionManager::restoreSessionFromScratch()
 
 bool SessionManager::restoreJustThePinnedTabs()
 {
-    QDomDocument document("session");
-
-    if (!readSessionDocument(document, m_sessionFilePath))
+    if (!readSavedSession())
         return false;
 
     bool done = false;
-    for (unsigned int winNo = 0; winNo < document.elementsByTagName("window").length(); winNo++)
+    Q_FOREACH(const SessionWindow & window, m_savedSession)
     {
-        QDomElement window = document.elementsByTagName("window").at(winNo).toElement();
-
         if (!areTherePinnedTabs(window))
             continue;
 
@@ -287,18 +655,16 @@ bool SessionManager::restoreJustThePinnedTabs()
 
 void SessionManager::restoreCrashedSession()
 {
-    QDomDocument document("session");
-
-    if (!readSessionDocument(document, m_sessionFilePath))
+    if (!readSavedSession())
         return;
 
-    for (unsigned int winNo = 0; winNo < document.elementsByTagName("window").length(); winNo++)
+    bool isFirstWindow = true;
+    Q_FOREACH(const SessionWindow & window, m_savedSession)
     {
-        QDomElement window = document.elementsByTagName("window").at(winNo).toElement();
-
-        RekonqWindow *tw = (winNo == 0)
+        RekonqWindow *tw = isFirstWindow
                         ? rApp->rekonqWindow()
                         : rApp->newWindow();
+        isFirstWindow = false;
 
         KUrl u = tw->currentWebWindow()->url();
         bool useCurrentTab = (u.isEmpty() || u.protocol() == QL1S("rekonq"));
@@ -313,21 +679,15 @@ void SessionManager::restoreCrashedSession()
 
 bool SessionManager::restoreWindow(RekonqWindow* window)
 {
-    QDomDocument document("session");
-
-    if (!readSessionDocument(document, m_sessionFilePath))
+    if (!readSavedSession())
         return false;
 
-    unsigned int winNo;
-
-    for (winNo = 0; winNo < document.elementsByTagName("window").length(); winNo++)
+    Q_FOREACH(const SessionWindow & savedWindow, m_savedSession)
     {
-        QDomElement savedWindowElement = document.elementsByTagName("window").at(winNo).toElement();
-
-        if (window->objectName() != savedWindowElement.attribute("name", ""))
+        if (window->objectName() != savedWindow.name)
             continue;
 
-        int currentTab = loadTabs(window, savedWindowElement, false);
+        int currentTab = loadTabs(window, savedWindow, false);
 
         window->tabWidget()->setCurrentIndex(currentTab);
 
@@ -341,33 +701,20 @@ bool SessionManager::restoreWindow(RekonqWindow* window)
 QList<TabHistory> SessionManager::closedSitesForWindow(const QString &windowName)
 {
     QList<TabHistory> list;
-    QDomDocument document("session");
 
-    if (!readSessionDocument(document, m_sessionFilePath))
+    if (!readSavedSession())
         return list;
 
-    for (unsigned int winNo = 0; winNo < document.elementsByTagName("tab").length(); winNo++)
+    Q_FOREACH(const SessionWindow & window, m_savedSession)
     {
-        QDomElement windowElement = document.elementsByTagName("window").at(winNo).toElement();
-
-        if (windowName != windowElement.attribute("name", ""))
+        if (windowName != window.name)
             continue;
-        
-        for (unsigned int tabNo = 0; tabNo < windowElement.elementsByTagName("tab").length(); tabNo++)
-        {
-            QDomElement tab = windowElement.elementsByTagName("tab").at(tabNo).toElement();
-
-            TabHistory tabHistory;
 
-            tabHistory.title = tab.attribute("title");
-            tabHistory.url = tab.attribute("url");
-
-            QDomCDATASection historySection = tab.firstChild().toCDATASection();
-            tabHistory.history = QByteArray::fromBase64(historySection.data().toAscii());
-
-            list << tabHistory;
+        Q_FOREACH(const SessionTab & tab, window.tabs)
+        {
+            list << tab.history;
         }
-        
+
         return list;
     }
 
@@ -385,84 +732,36 @@ bool SessionManager::saveYourSession(int index)
     const QString & sessionPath = KStandardDirs::locateLocal("appdata" , QL1S("usersessions/"));
     const QString & sessionName = QL1S("ses") + QString::number(index);
     
-    QFile sessionFile(sessionPath + sessionName);
-    if (!sessionFile.open(QFile::WriteOnly | QFile::Truncate))
-    {
-        kDebug() << "Unable to open session file" << sessionFile.fileName();
-        return false;
-    }
-    
-    RekonqWindowList wl = rApp->rekonqWindowList();
-    QDomDocument document("session");
-    QDomElement session = document.createElement("session");
-    document.appendChild(session);
-
-    Q_FOREACH(const QWeakPointer<RekonqWindow> &w, wl)
-    {
-        if (w.data()->isPrivateBrowsingMode())
-            continue;
-        
-        QDomElement window = document.createElement("window");
-        int tabInserted = 0;
-
-        window.setAttribute("name", w.data()->objectName());
-        
-        TabWidget *tw = w.data()->tabWidget();
-        for (signed int tabNo = 0; tabNo < tw->count(); tabNo++)
-        {
-            KUrl u = tw->webWindow(tabNo)->url();
-
-            tabInserted++;
-            QDomElement tab = document.createElement("tab");
-            tab.setAttribute("title", tw->webWindow(tabNo)->title()); // redundant, but needed for closedSites()
-            // as there's not way to read out the historyData
-            tab.setAttribute("url", u.url());
-            if (tw->currentIndex() == tabNo)
-            {
-                tab.setAttribute("currentTab", 1);
-            }
-            if (tw->tabBar()->tabData(tabNo).toBool()) // pinned tab info
-            {
-                tab.setAttribute("pinned", 1);
-            }
-            QByteArray history;
-            QDataStream historyStream(&history, QIODevice::ReadWrite);
-            historyStream << *(tw->webWindow(tabNo)->page()->history());
-            QDomCDATASection historySection = document.createCDATASection(history.toBase64());
-
-            tab.appendChild(historySection);
-            window.appendChild(tab);
-        }
-        
-        if (tabInserted > 0)
-            session.appendChild(window);
-    }
+    return writeSessionFile(currentSession(), sessionPath + sessionName);
+}
 
-    QTextStream TextStream(&sessionFile);
-    document.save(TextStream, 2);
-    sessionFile.close();
+    
+QList<SessionWindow> SessionManager::yourSessionWindows(int index)
+{
+    const QString & sessionPath = KStandardDirs::locateLocal("appdata" , QL1S("usersessions/"));
+    const QString & sessionName = QL1S("ses") + QString::number(index);
 
-    return true;
+    QList<SessionWindow> session;
+    readSessionFile(session, sessionPath + sessionName, false);
+    return session;
 }
 
-    
+
 bool SessionManager::restoreYourSession(int index)
 {
     const QString & sessionPath = KStandardDirs::locateLocal("appdata" , QL1S("usersessions/"));
     const QString & sessionName = QL1S("ses") + QString::number(index);
     
-    QDomDocument document("session");
+    QList<SessionWindow> session;
 
-    if (!readSessionDocument(document,sessionPath + sessionName))
+    if (!readSessionFile(session, sessionPath + sessionName))
         return false;
 
     // trace the windows to delete
     RekonqWindowList wList = rApp->rekonqWindowList();
     
-    for (unsigned int winNo = 0; winNo < document.elementsByTagName("window").length(); winNo++)
+    Q_FOREACH(const SessionWindow & window, session)
     {
-        QDomElement window = document.elementsByTagName("window").at(winNo).toElement();
-
         RekonqWindow *tw = rApp->newWindow();
 
         int currentTab = loadTabs(tw, window, true, false);
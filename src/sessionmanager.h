@@ -33,16 +33,44 @@
 // Rekonq Includes
 #include "rekonq_defines.h"
 
+// Local Includes
+#include "tabhistory.h"
+
 // Qt Includes
 #include <QObject>
 #include <QString>
 #include <QWeakPointer>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QDateTime>
+#include <QFile>
+#include <QUrl>
 
 // Forward Declarations
-class TabHistory;
-
+class AutoSaver;
 class RekonqWindow;
 
+class QWebHistory;
+
+
+// A saved tab: title, url && its (serialized) history
+struct SessionTab
+{
+    SessionTab() : isCurrent(false), isPinned(false) {}
+
+    TabHistory history;
+    bool isCurrent;
+    bool isPinned;
+};
+
+
+struct SessionWindow
+{
+    QString name;
+    QList<SessionTab> tabs;
+};
+
 
 /**
   * Session Management: Needs clean up :)
@@ -60,6 +88,18 @@ public:
      */
     static SessionManager *self();
 
+    ~SessionManager();
+
+    // The tab events recorded in the journal, between two snapshots
+    enum TabEvent
+    {
+        TabAdded = 1,
+        TabClosed,
+        TabNavigated,
+        TabMoved,
+        TabPinned
+    };
+
     inline void setSessionManagementEnabled(bool on)
     {
         m_isSessionEnabled = on;
@@ -73,6 +113,20 @@ public:
     bool saveYourSession(int);
     bool restoreYourSession(int);
 
+    // windows && tabs of a saved session, without their histories
+    QList<SessionWindow> yourSessionWindows(int);
+
+    // When the sessionJournal option is on, tab events are appended to a journal,
+    // replayed on the last snapshot when the session is restored.
+    // value is the new index of a moved tab, or whether a tab has been pinned
+    void journalTabEvent(TabEvent event, const QString &windowName, int index,
+                         const QString &url = QString(), int value = 0);
+
+    // NOTE: the journal format, public for the unit tests
+    static QByteArray journalRecord(quint32 serial, TabEvent event, const QString &windowName, int index,
+                                    const QString &url = QString(), int value = 0);
+    static void replayJournal(QList<SessionWindow> &session, QIODevice *journal, quint32 snapshotSerial);
+
 private:
     explicit SessionManager(QObject *parent = 0);
 
@@ -83,7 +137,10 @@ public Q_SLOTS:
     // This method restores (eventually) the tabs present
     // if there are NO pinned tabs to restore, it returns FALSE...
     bool restoreJustThePinnedTabs();
+    // Session is saved a few seconds after the last change
     void saveSession();
+    // ... or now, e.g. when a window is going to be closed
+    void saveSessionNow();
 
     void manageSessions();
     
@@ -92,11 +149,48 @@ private Q_SLOTS:
     // after a crash
     void restoreCrashedSession();
 
+    void takeSessionSnapshot();
+    void sessionWritten();
+
 private:
+    QList<SessionWindow> currentSession();
+    void writePendingSession();
+
+    // parses the session file, the first time it is needed
+    bool readSavedSession();
+
     QString m_sessionFilePath;
-    bool m_safe;
     bool m_isSessionEnabled;
 
+    AutoSaver *m_saveTimer;
+
+    // the session is written in a worker thread, one snapshot at a time
+    QFutureWatcher<bool> m_saveWatcher;
+    QList<SessionWindow> m_pendingSession;
+    bool m_hasPendingSession;
+
+    // the session file contents, shared by all the restore methods
+    QList<SessionWindow> m_savedSession;
+    bool m_isSavedSessionRead;
+    bool m_hasSavedSession;
+
+    QFile m_journal;
+    quint32 m_journalSerial;
+    quint32 m_pendingJournalSerial;
+    quint32 m_writingJournalSerial;
+
+    // the serialized tab histories: re-serialized just when they change
+    struct HistoryCacheEntry
+    {
+        int count;
+        int currentIndex;
+        QUrl currentUrl;
+        QDateTime lastVisited;
+        QByteArray history;
+    };
+    typedef QHash<const QWebHistory *, HistoryCacheEntry> HistoryCache;
+    HistoryCache m_historyCache;
+
     static QWeakPointer<SessionManager> s_sessionManager;
 };
 
@@ -50,10 +50,22 @@ SessionWidget::SessionWidget(QWidget *parent)
 
     QStringList ses = ReKonfig::savedSessions();
 
-    Q_FOREACH(const QString & s, ses)
+    for (int i = 0; i < ses.count(); ++i)
     {
-        QListWidgetItem *item = new QListWidgetItem(s, listWidget, 0);
+        QListWidgetItem *item = new QListWidgetItem(ses.at(i), listWidget, 0);
         item->setFlags (item->flags () | Qt::ItemIsEditable);
+
+        // just the session index is read here, not the tab histories
+        QStringList titles;
+        Q_FOREACH(const SessionWindow & w, SessionManager::self()->yourSessionWindows(i))
+        {
+            Q_FOREACH(const SessionTab & t, w.tabs)
+            {
+                titles << (t.history.title.isEmpty() ? t.history.url : t.history.title);
+            }
+        }
+        item->setToolTip(i18np("1 tab", "%1 tabs", titles.count()) + QL1S("\n") + titles.join(QL1S("\n")));
+
         listWidget->addItem(item);
     }
     
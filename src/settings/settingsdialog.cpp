@@ -34,6 +34,7 @@
 
 // Local Includes
 #include "searchengine.h"
+#include "historymanager.h"
 
 // Widget Includes
 #include "advancedwidget.h"
@@ -182,6 +183,7 @@ void SettingsDialog::saveSettings()
     d->privacyWidg->reload();
 
     SearchEngine::reload();
+    HistoryManager::self()->updateSearchResults();
 
     updateButtons();
     emit settingsChanged("ReKonfig");
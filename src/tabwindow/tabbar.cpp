@@ -36,6 +36,7 @@
 #include "tabwidget.h"
 
 #include "tabhighlighteffect.h"
+#include "tabplaceholder.h"
 #include "tabpreviewpopup.h"
 #include "webwindow.h"
 
@@ -491,21 +492,37 @@ void TabBar::showTabPreview()
 
     TabWidget *tabW = qobject_cast<TabWidget *>(parent());
 
-    WebWindow *indexedTab = tabW->webWindow(m_currentTabPreviewIndex);
     WebWindow *currentTab = tabW->webWindow(currentIndex());
-
-    // check if view && currentView exist before using them :)
-    if (!currentTab || !indexedTab)
-        return;
-
-    // no previews during load
-    if (indexedTab->isLoading())
+    if (!currentTab)
         return;
 
     int w = c_baseTabWidth;
     int h = w * tabW->size().height() / tabW->size().width();
 
-    m_previewPopup = new TabPreviewPopup(indexedTab->tabPreview(w, h), indexedTab->url().url() , this);
+    // discarded tabs kept the preview of the page they showed
+    TabPlaceholder *discardedTab = tabW->placeholder(m_currentTabPreviewIndex);
+    if (discardedTab)
+    {
+        if (!discardedTab->isDiscarded() || discardedTab->preview().isNull())
+            return;
+
+        QPixmap preview = discardedTab->preview().scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        m_previewPopup = new TabPreviewPopup(preview, discardedTab->url().url(), this);
+    }
+    else
+    {
+        WebWindow *indexedTab = tabW->webWindow(m_currentTabPreviewIndex);
+
+        // check if view exists before using it :)
+        if (!indexedTab)
+            return;
+
+        // no previews during load
+        if (indexedTab->isLoading())
+            return;
+
+        m_previewPopup = new TabPreviewPopup(indexedTab->tabPreview(w, h), indexedTab->url().url() , this);
+    }
 
     int tabBarWidth = tabW->size().width();
     int leftIndex = tabRect(m_currentTabPreviewIndex).x() + (tabRect(m_currentTabPreviewIndex).width() - w) / 2;
@@ -559,6 +576,7 @@ void TabBar::pinTab()
 
     // set this tab data true to know this has been pinned
     setTabData(index, true);
+    w->journalTabPinned(index, true);
 
     tabButton(index, QTabBar::RightSide)->hide();
     setTabText(index, QString());
@@ -573,7 +591,7 @@ void TabBar::pinTab()
     setTabButton(index, QTabBar::LeftSide, 0);
     setTabButton(index, QTabBar::LeftSide, label);
 
-    KIcon ic = IconManager::self()->iconForUrl(w->webWindow(index)->url());
+    KIcon ic = IconManager::self()->iconForUrl(w->urlAt(index));
     label->setPixmap(ic.pixmap(16, 16));
 
     SessionManager::self()->saveSession();
@@ -605,10 +623,11 @@ void TabBar::unpinTab()
     index = availableIndex;
 
     tabButton(index, QTabBar::RightSide)->show();
-    setTabText(index, w->webWindow(index)->title());
+    setTabText(index, w->titleAt(index));
 
     // set the tab data false to forget this pinned tab
     setTabData(index, false);
+    w->journalTabPinned(index, false);
 
     // workaround: "fix" the icon (or at least, try to...)
     QLabel *label = qobject_cast<QLabel* >(tabButton(index, QTabBar::LeftSide));
@@ -620,7 +639,7 @@ void TabBar::unpinTab()
     setTabButton(index, QTabBar::LeftSide, 0);
     setTabButton(index, QTabBar::LeftSide, label);
 
-    KIcon ic = IconManager::self()->iconForUrl(w->webWindow(index)->url());
+    KIcon ic = IconManager::self()->iconForUrl(w->urlAt(index));
     label->setPixmap(ic.pixmap(16, 16));
 
     SessionManager::self()->saveSession();
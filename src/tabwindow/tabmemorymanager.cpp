@@ -0,0 +1,197 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Self Includes
+#include "tabmemorymanager.h"
+#include "tabmemorymanager.moc"
+
+// Auto Includes
+#include "rekonq.h"
+
+// Local Includes
+#include "application.h"
+#include "tabwidget.h"
+
+// KDE Includes
+#include <KDebug>
+
+// Qt Includes
+#include <QMultiMap>
+#include <QMutableListIterator>
+#include <QPair>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+#include <QFile>
+#include <unistd.h>
+#endif
+
+
+// How often memory usage is checked, when a budget has been set
+static const int MEMORY_CHECK_INTERVAL = 10 * 1000;
+
+// Once over budget, tabs are discarded until memory goes under this percentage of it
+static const int LOW_WATER_MARK = 80;
+
+
+// Resident set size of the rekonq process, in bytes (0 if unknown)
+static qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QL1S("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return 0;
+
+    // size resident shared text lib data dt, in pages
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count() < 2)
+        return 0;
+
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QWeakPointer<TabMemoryManager> TabMemoryManager::s_tabMemoryManager;
+
+
+TabMemoryManager *TabMemoryManager::self()
+{
+    if (s_tabMemoryManager.isNull())
+    {
+        s_tabMemoryManager = new TabMemoryManager(qApp);
+    }
+    return s_tabMemoryManager.data();
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+TabMemoryManager::TabMemoryManager(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_isDiscarding(false)
+    , m_isStalled(false)
+    , m_lastResidentMemory(0)
+{
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(checkMemoryUsage()));
+}
+
+
+void TabMemoryManager::addTabWidget(TabWidget *tabWidget)
+{
+    m_tabWidgets.append(tabWidget);
+
+    if (!m_timer->isActive())
+        m_timer->start(MEMORY_CHECK_INTERVAL);
+}
+
+
+void TabMemoryManager::checkMemoryUsage()
+{
+    QMutableListIterator< QWeakPointer<TabWidget> > it(m_tabWidgets);
+    while (it.hasNext())
+    {
+        if (it.next().isNull())
+            it.remove();
+    }
+
+    if (m_tabWidgets.isEmpty())
+    {
+        m_timer->stop();
+        return;
+    }
+
+    const qint64 budget = qint64(ReKonfig::tabsMemoryBudget()) * 1024 * 1024;
+    const qint64 memory = budget > 0 ? residentMemory() : 0;
+    if (memory <= 0)
+    {
+        m_isDiscarding = false;
+        m_isStalled = false;
+        return;
+    }
+
+    const qint64 lowWaterMark = budget / 100 * LOW_WATER_MARK;
+
+    if (m_isStalled)
+    {
+        // the last discard released nothing: try again just when
+        // usage went down on its own, or grew some more
+        if (memory > lowWaterMark && memory < m_lastResidentMemory + budget - lowWaterMark)
+            return;
+        m_isStalled = false;
+    }
+    else if (m_isDiscarding && memory >= m_lastResidentMemory)
+    {
+        kDebug() << "Discarding tabs does not lower memory usage: stop discarding";
+        m_isDiscarding = false;
+        m_isStalled = true;
+        m_lastResidentMemory = memory;
+        return;
+    }
+
+    if (memory > budget)
+        m_isDiscarding = true;
+    else if (memory <= lowWaterMark)
+        m_isDiscarding = false;
+
+    // one tab per check: next check will see the memory released
+    if (m_isDiscarding)
+        m_isDiscarding = discardLeastRecentTab();
+
+    m_lastResidentMemory = memory;
+}
+
+
+bool TabMemoryManager::discardLeastRecentTab()
+{
+    typedef QPair<TabWidget *, int> Tab;
+
+    QMultiMap<qint64, Tab> tabsByActivation;
+    Q_FOREACH(const QWeakPointer<TabWidget> & tabWidget, m_tabWidgets)
+    {
+        TabWidget *w = tabWidget.data();
+        for (int i = 0; i < w->count(); ++i)
+        {
+            if (!w->placeholder(i))
+                tabsByActivation.insert(w->lastActivation(i), Tab(w, i));
+        }
+    }
+
+    Q_FOREACH(const Tab & tab, tabsByActivation)
+    {
+        if (tab.first->discardTab(tab.second))
+            return true;
+    }
+
+    return false;
+}
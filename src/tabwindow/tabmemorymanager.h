@@ -0,0 +1,85 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+#ifndef TAB_MEMORY_MANAGER_H
+#define TAB_MEMORY_MANAGER_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Qt Includes
+#include <QObject>
+#include <QList>
+#include <QWeakPointer>
+
+// Forward Declarations
+class TabWidget;
+class QTimer;
+
+
+/**
+ * Keeps the memory used by rekonq under the configured budget
+ * (tabsMemoryBudget, in MB) discarding background tabs, in every window.
+ *
+ * Once over budget, the least recently activated tab is discarded on each
+ * check, until memory goes under a low water mark. If a discard doesn't
+ * lower memory usage, discarding stops until usage changes enough.
+ *
+ */
+class TabMemoryManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Entry point.
+     * Access to TabMemoryManager class by using
+     * TabMemoryManager::self()->thePublicMethodYouNeed()
+     */
+    static TabMemoryManager *self();
+
+    void addTabWidget(TabWidget *tabWidget);
+
+private Q_SLOTS:
+    void checkMemoryUsage();
+
+private:
+    TabMemoryManager(QObject *parent = 0);
+
+    bool discardLeastRecentTab();
+
+    QTimer *m_timer;
+    QList< QWeakPointer<TabWidget> > m_tabWidgets;
+
+    bool m_isDiscarding;
+    bool m_isStalled;
+    qint64 m_lastResidentMemory;
+
+    static QWeakPointer<TabMemoryManager> s_tabMemoryManager;
+};
+
+#endif // TAB_MEMORY_MANAGER_H
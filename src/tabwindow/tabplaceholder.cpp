@@ -0,0 +1,59 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+
+// Self Includes
+#include "tabplaceholder.h"
+#include "tabplaceholder.moc"
+
+
+TabPlaceholder::TabPlaceholder(const TabHistory &history, QWidget *parent)
+    : QWidget(parent)
+    , m_history(history)
+    , m_isDiscarded(false)
+{
+}
+
+
+void TabPlaceholder::setDiscarded(const QPixmap &preview)
+{
+    m_preview = preview;
+    m_isDiscarded = true;
+}
+
+
+KUrl TabPlaceholder::url() const
+{
+    return KUrl(m_history.url);
+}
+
+
+QString TabPlaceholder::title() const
+{
+    return m_history.title.isEmpty()
+           ? m_history.url
+           : m_history.title;
+}
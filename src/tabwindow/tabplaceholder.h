@@ -0,0 +1,88 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+
+#ifndef TAB_PLACEHOLDER_H
+#define TAB_PLACEHOLDER_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "tabhistory.h"
+
+// KDE Includes
+#include <KUrl>
+
+// Qt Includes
+#include <QPixmap>
+#include <QWidget>
+
+
+/**
+ * A tab not loaded (yet): restored tabs are kept this way
+ * until they are activated, without any web class behind them.
+ * It just remembers what has to be loaded: title, url and history.
+ *
+ * Tabs discarded to save memory become placeholders, too:
+ * they also keep a preview of the page they showed.
+ *
+ */
+class TabPlaceholder : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TabPlaceholder(const TabHistory &history, QWidget *parent = 0);
+
+    const TabHistory &history() const
+    {
+        return m_history;
+    }
+
+    KUrl url() const;
+    QString title() const;
+
+    QPixmap preview() const
+    {
+        return m_preview;
+    }
+
+    bool isDiscarded() const
+    {
+        return m_isDiscarded;
+    }
+
+    void setDiscarded(const QPixmap &preview);
+
+private:
+    TabHistory m_history;
+    QPixmap m_preview;
+    bool m_isDiscarded;
+};
+
+#endif // TAB_PLACEHOLDER_H
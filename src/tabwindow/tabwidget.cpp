@@ -36,6 +36,8 @@
 #include "rekonqwindow.h"
 
 #include "tabbar.h"
+#include "tabmemorymanager.h"
+#include "tabplaceholder.h"
 
 #include "webpage.h"
 #include "webtab.h"
@@ -64,23 +66,58 @@
 #include <KWindowSystem>
 
 // Qt Includes
+#include <QDateTime>
 #include <QDesktopWidget>
 #include <QLabel>
 #include <QMovie>
 #include <QTabBar>
 #include <QToolButton>
 #include <QSignalMapper>
+#include <QTimer>
+#include <QWebElement>
+#include <QWebFrame>
 #include <QWebHistory>
 #include <QWebSettings>
 
 
+// The preview width shown by the tab bar for discarded tabs
+static const int DISCARDED_PREVIEW_WIDTH = 250;
+
+
+// QtWebKit does not tell if a page is playing sound: look for running media and plugins
+static bool isPlayingMedia(QWebFrame *frame)
+{
+    if (!frame->findAllElements(QL1S("embed, object")).toList().isEmpty())
+        return true;
+
+    Q_FOREACH(QWebElement element, frame->findAllElements(QL1S("audio, video")))
+    {
+        const QVariant paused = element.evaluateJavaScript(QL1S("this.paused"));
+        if (!paused.isValid() || !paused.toBool())
+            return true;
+    }
+
+    Q_FOREACH(QWebFrame *child, frame->childFrames())
+    {
+        if (isPlayingMedia(child))
+            return true;
+    }
+
+    return false;
+}
+
+
 TabWidget::TabWidget(bool withTab, bool PrivateBrowsingMode, QWidget *parent)
     : KTabWidget(parent)
     , _addTabButton(new QToolButton(this))
     , _openedTabsCounter(0)
     , _isPrivateBrowsing(PrivateBrowsingMode)
     , _ac(new KActionCollection(this))
-    , _lastCurrentTabIndex(-1)
+    , _preloadedTabs(0)
+    , _discardedTabs(0)
+    , _reloadedTabs(0)
+    , _isReplacingTab(false)
+    , _isMovingTab(false)
 {
     init();
 
@@ -101,7 +138,11 @@ TabWidget::TabWidget(WebPage *pg, QWidget *parent)
     , _openedTabsCounter(0)
     , _isPrivateBrowsing(false)
     , _ac(new KActionCollection(this))
-    , _lastCurrentTabIndex(-1)
+    , _preloadedTabs(0)
+    , _discardedTabs(0)
+    , _reloadedTabs(0)
+    , _isReplacingTab(false)
+    , _isMovingTab(false)
 {
     init();
 
@@ -141,6 +182,9 @@ void TabWidget::init()
 
     connect(tabBar, SIGNAL(tabLayoutChanged()),     this,   SLOT(updateNewTabButtonPosition()));
 
+    // tabs dragged by the user
+    connect(tabBar, SIGNAL(tabMoved(int,int)),      this,   SLOT(journalTabMove(int,int)));
+
     // ============================== Tab Window Actions ====================================
     _ac->addAssociatedWidget(this);
 
@@ -246,6 +290,11 @@ void TabWidget::init()
         m_recentlyClosedTabs.removeAll(tab);
         m_recentlyClosedTabs.prepend(tab);
     }
+
+    // ----------------------------------------------------------------------------------------------
+    // private tabs are never discarded: we cannot reload them from the history
+    if (!_isPrivateBrowsing)
+        TabMemoryManager::self()->addTabWidget(this);
 }
 
 
@@ -290,6 +339,212 @@ WebWindow *TabWidget::webWindow(int index) const
 }
 
 
+TabPlaceholder *TabWidget::placeholder(int index) const
+{
+    return qobject_cast<TabPlaceholder *>(this->widget(index));
+}
+
+
+KUrl TabWidget::urlAt(int index) const
+{
+    TabPlaceholder *p = placeholder(index);
+    if (p)
+        return p->url();
+
+    WebWindow *tab = webWindow(index);
+    if (tab)
+        return tab->url();
+
+    return KUrl();
+}
+
+
+QString TabWidget::titleAt(int index) const
+{
+    TabPlaceholder *p = placeholder(index);
+    if (p)
+        return p->title();
+
+    WebWindow *tab = webWindow(index);
+    if (tab)
+        return tab->title();
+
+    return QString();
+}
+
+
+int TabWidget::addPlaceholderTab(const TabHistory &history)
+{
+    // the first tab of a window has to be a real one
+    if (count() == 0)
+    {
+        TabHistory h = history;
+        loadUrl(KUrl(history.url), Rekonq::NewTab, &h);
+        return currentIndex();
+    }
+
+    TabPlaceholder *p = new TabPlaceholder(history, this);
+
+    QString tabTitle = p->title();
+    tabTitle.replace('&', "&&");
+    int index = addTab(p, tabTitle);
+
+    setTabFavicon(index, p->url());
+
+    if (ReKonfig::hoveringTabOption() == 1)
+        tabBar()->setTabToolTip(index, p->title());
+    else if (ReKonfig::hoveringTabOption() == 2)
+        tabBar()->setTabToolTip(index, history.url);
+
+    if (ReKonfig::preloadRestoredTabs() > 0)
+    {
+        _preloadQueue << QWeakPointer<TabPlaceholder>(p);
+        if (_preloadQueue.count() == 1 && _preloadingTab.isNull())
+            QTimer::singleShot(0, this, SLOT(preloadNextTab()));
+    }
+
+    return index;
+}
+
+
+WebWindow *TabWidget::loadPlaceholderTab(int index)
+{
+    TabPlaceholder *p = placeholder(index);
+    if (!p)
+        return webWindow(index);
+
+    WebWindow *tab = prepareNewTab();
+    replaceTab(index, tab);
+
+    if (p->isDiscarded())
+    {
+        _reloadedTabs++;
+        kDebug() << "Reloading discarded tab" << index << "(" << _reloadedTabs << "so far)";
+    }
+
+    TabHistory history = p->history();
+    p->deleteLater();
+
+    history.applyHistory(tab->page()->history());
+    tab->load(KUrl(history.url));
+
+    return tab;
+}
+
+
+void TabWidget::replaceTab(int index, QWidget *tab)
+{
+    // swap the widgets, leaving the tab as it is
+    const bool isCurrent = (index == currentIndex());
+    const bool isPinned = tabBar()->tabData(index).toBool();
+    const QString label = tabText(index);
+    const QString toolTip = tabBar()->tabToolTip(index);
+
+    tab->setProperty("lastActivation", widget(index)->property("lastActivation"));
+
+    setUpdatesEnabled(false);
+    blockSignals(true);
+    _isReplacingTab = true;
+    removeTab(index);
+    KTabWidget::insertTab(index, tab, label);
+    if (isCurrent)
+        setCurrentIndex(index);
+    _isReplacingTab = false;
+    blockSignals(false);
+
+    tabBar()->setTabData(index, isPinned);
+    tabBar()->setTabToolTip(index, toolTip);
+    if (isPinned && tabBar()->tabButton(index, QTabBar::RightSide))
+        tabBar()->tabButton(index, QTabBar::RightSide)->hide();
+    setUpdatesEnabled(true);
+}
+
+
+void TabWidget::setTabFavicon(int index, const KUrl &url)
+{
+    QLabel *label = new QLabel(this);
+    label->setPixmap(IconManager::self()->iconForUrl(url).pixmap(16, 16));
+    tabBar()->setTabButton(index, QTabBar::LeftSide, label);
+}
+
+
+bool TabWidget::canDiscardTab(int index)
+{
+    if (index == currentIndex() || tabBar()->tabData(index).toBool())
+        return false;
+
+    WebWindow *tab = webWindow(index);
+    if (!tab || tab->isLoading() || tab->tabView()->part())
+        return false;
+
+    if (tab->url().isEmpty() || tab->page()->settings()->testAttribute(QWebSettings::PrivateBrowsingEnabled))
+        return false;
+
+    return !isPlayingMedia(tab->page()->mainFrame());
+}
+
+
+bool TabWidget::discardTab(int index)
+{
+    if (!canDiscardTab(index))
+        return false;
+
+    WebWindow *tab = webWindow(index);
+
+    TabHistory history(tab->page()->history());
+    history.title = tab->title();
+    history.url = tab->url().url();
+
+    // keep what the tab bar shows on hovering
+    const int w = DISCARDED_PREVIEW_WIDTH;
+    const int h = w * size().height() / qMax(size().width(), 1);
+
+    TabPlaceholder *p = new TabPlaceholder(history, this);
+    p->setDiscarded(tab->tabPreview(w, h));
+
+    replaceTab(index, p);
+    setTabFavicon(index, p->url());
+
+    if (_preloadingTab.data() == tab)
+        _preloadingTab.clear();
+    tab->deleteLater();
+
+    _discardedTabs++;
+    kDebug() << "Discarded tab" << index << "(" << _discardedTabs << "so far)";
+    return true;
+}
+
+
+qint64 TabWidget::lastActivation(int index) const
+{
+    return widget(index)->property("lastActivation").toLongLong();
+}
+
+
+void TabWidget::preloadNextTab()
+{
+    _preloadingTab.clear();
+
+    while (!_preloadQueue.isEmpty() && _preloadedTabs < ReKonfig::preloadRestoredTabs())
+    {
+        TabPlaceholder *p = _preloadQueue.takeFirst().data();
+        if (!p)
+            continue;
+
+        int index = indexOf(p);
+        if (index == -1)
+            continue;
+
+        // just one at a time: the next one when this has been loaded
+        _preloadingTab = loadPlaceholderTab(index);
+        _preloadedTabs++;
+        return;
+    }
+
+    _preloadQueue.clear();
+}
+
+
 QList<TabHistory> TabWidget::recentlyClosedTabs()
 {
     return m_recentlyClosedTabs;
@@ -407,10 +662,31 @@ void TabWidget::currentChanged(int newIndex)
 {
     _openedTabsCounter = 0;
 
+    // time to load a restored (or discarded) tab
+    if (placeholder(newIndex))
+        loadPlaceholderTab(newIndex);
+
+    if (widget(newIndex))
+        widget(newIndex)->setProperty("lastActivation", QDateTime::currentMSecsSinceEpoch());
+
     tabBar()->setTabHighlighted(newIndex, false);
 
-    // update window title & icon
     WebWindow* tab = webWindow(newIndex);
+
+    // NOTE: the previous tab is tracked by pointer, not by index:
+    // tabs can be moved or closed since it was current
+    WebWindow *oldTab = _lastCurrentTab.data();
+    _lastCurrentTab = tab;
+
+    if (oldTab && oldTab != tab)
+    {
+        oldTab->tabView()->focusOut();
+
+        // what the user saw last: the preview of the tab, when it will be closed
+        oldTab->page()->captureSnapshot();
+    }
+
+    // update window title & icon
     if (!tab)
         return;
 
@@ -423,16 +699,6 @@ void TabWidget::currentChanged(int newIndex)
     : emit windowTitleChanged(t + QL1S(" - rekonq"));
 
     tab->checkFocus();
-    
-    // ----------------------------------------------------
-    
-    WebWindow *oldTab = webWindow(_lastCurrentTabIndex);
-    if (!oldTab)
-        return;
-    
-    oldTab->tabView()->focusOut();
-    
-    _lastCurrentTabIndex = newIndex;
 }
 
 
@@ -500,6 +766,9 @@ void TabWidget::tabUrlChanged(const QUrl &url)
     int index = indexOf(tab);
     if (ReKonfig::hoveringTabOption() == 2)
         tabBar()->setTabToolTip(index, url.toString());
+
+    if (!_isPrivateBrowsing)
+        SessionManager::self()->journalTabEvent(SessionManager::TabNavigated, parentWidget()->objectName(), index, url.toString());
 }
 
 
@@ -578,6 +847,9 @@ void TabWidget::tabLoadFinished(bool ok)
     if (!tab)
         return;
 
+    if (tab == _preloadingTab.data())
+        QTimer::singleShot(0, this, SLOT(preloadNextTab()));
+
     int index = indexOf(tab);
 
     if (-1 == index)
@@ -624,6 +896,14 @@ void TabWidget::cloneTab(int index)
     if (index < 0 || index >= count())
         return;
 
+    TabPlaceholder *p = placeholder(index);
+    if (p)
+    {
+        TabHistory clonedHistory = p->history();
+        loadUrl(p->url(), Rekonq::NewTab, &clonedHistory);
+        return;
+    }
+
     QUrl u = webWindow(index)->url();
     QWebHistory* history = webWindow(index)->page()->history();
     TabHistory clonedHistory(history);
@@ -639,7 +919,7 @@ void TabWidget::closeTab(int index, bool del)
     if (index < 0 || index >= count())
         return;
 
-    WebWindow *tabToClose = webWindow(index);
+    QWidget *tabToClose = widget(index);
     if (!tabToClose)
         return;
 
@@ -656,15 +936,26 @@ void TabWidget::closeTab(int index, bool del)
         return;
     }
 
-    if (!tabToClose->url().isEmpty()
-//             && tabToClose->url().scheme() != QL1S("rekonq")
-            && !tabToClose->page()->settings()->testAttribute(QWebSettings::PrivateBrowsingEnabled)
+    TabPlaceholder *p = placeholder(index);
+    WebWindow *webTabToClose = webWindow(index);
+
+    if (p || (!webTabToClose->url().isEmpty()
+//             && webTabToClose->url().scheme() != QL1S("rekonq")
+            && !webTabToClose->page()->settings()->testAttribute(QWebSettings::PrivateBrowsingEnabled))
        )
     {
         const int recentlyClosedTabsLimit = 8;
-        TabHistory history(tabToClose->page()->history());
-        history.title = tabToClose->title();
-        history.url = tabToClose->url().url();
+        TabHistory history;
+        if (p)
+        {
+            history = p->history();
+        }
+        else
+        {
+            history = TabHistory(webTabToClose->page()->history());
+            history.title = webTabToClose->title();
+            history.url = webTabToClose->url().url();
+        }
         history.position = index;
 
         m_recentlyClosedTabs.removeAll(history);
@@ -708,7 +999,7 @@ void TabWidget::detachTab(int index, RekonqWindow *toWindow)
     if (index < 0 || index >= count())
         return;
 
-    WebWindow *tab = webWindow(index);
+    WebWindow *tab = loadPlaceholderTab(index);
     KUrl u = tab->url();
     if (u.scheme() == QL1S("rekonq"))
     {
@@ -761,7 +1052,11 @@ void TabWidget::reloadTab(int index)
     if (index < 0 || index >= count())
         return;
 
+    // nothing to reload in a placeholder: it will be loaded when activated
     WebWindow *reloadingTab = webWindow(index);
+    if (!reloadingTab)
+        return;
+
     QAction *action = reloadingTab->page()->action(QWebPage::Reload);
     action->trigger();
 }
@@ -782,8 +1077,7 @@ void TabWidget::bookmarkAllTabs()
     KBookmarkGroup folderGroup = rGroup.createNewFolder(i18n("Bookmarked tabs: %1", QDate::currentDate().toString()));
     for (int i = 0; i < count(); ++i)
     {
-        WebWindow *tab = webWindow(i);
-        KBookmark bk = folderGroup.addBookmark(tab->title(), tab->url());
+        KBookmark bk = folderGroup.addBookmark(titleAt(i), urlAt(i));
     }
     
     // force bookmarks saving
@@ -864,8 +1158,13 @@ void TabWidget::setFullScreen(bool makeFullScreen)
 
     KToggleFullScreenAction::setFullScreen(window(), makeFullScreen);
 
+    // NOTE: placeholders will check it when loaded
     for (int i = 0; i < count(); i++)
-        webWindow(i)->setWidgetsHidden(makeFullScreen);
+    {
+        WebWindow *tab = webWindow(i);
+        if (tab)
+            tab->setWidgetsHidden(makeFullScreen);
+    }
 }
 
 
@@ -937,3 +1236,54 @@ int TabWidget::insertTab(int index, QWidget *page, const QIcon &icon, const QStr
 
 
 // --------------------------------------------------------------------------------------
+
+
+void TabWidget::tabInserted(int index)
+{
+    KTabWidget::tabInserted(index);
+
+    if (_isPrivateBrowsing || _isReplacingTab || _isMovingTab)
+        return;
+
+    SessionManager::self()->journalTabEvent(SessionManager::TabAdded, parentWidget()->objectName(), index, urlAt(index).url());
+}
+
+
+void TabWidget::tabRemoved(int index)
+{
+    KTabWidget::tabRemoved(index);
+
+    if (_isPrivateBrowsing || _isReplacingTab || _isMovingTab)
+        return;
+
+    SessionManager::self()->journalTabEvent(SessionManager::TabClosed, parentWidget()->objectName(), index);
+}
+
+
+void TabWidget::moveTab(int from, int to)
+{
+    // a move is journaled as such, not as a closed and an added tab
+    _isMovingTab = true;
+    KTabWidget::moveTab(from, to);
+    _isMovingTab = false;
+
+    journalTabMove(from, to);
+}
+
+
+void TabWidget::journalTabMove(int from, int to)
+{
+    if (_isPrivateBrowsing || _isMovingTab || from == to)
+        return;
+
+    SessionManager::self()->journalTabEvent(SessionManager::TabMoved, parentWidget()->objectName(), from, QString(), to);
+}
+
+
+void TabWidget::journalTabPinned(int index, bool pinned)
+{
+    if (_isPrivateBrowsing)
+        return;
+
+    SessionManager::self()->journalTabEvent(SessionManager::TabPinned, parentWidget()->objectName(), index, QString(), pinned);
+}
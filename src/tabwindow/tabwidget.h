@@ -35,6 +35,9 @@
 #include <KTabWidget>
 #include <KActionCollection>
 
+// Qt Includes
+#include <QWeakPointer>
+
 // Forward Declarations
 class KUrl;
 
@@ -43,6 +46,7 @@ class QToolButton;
 class TabHistory;
 
 class TabBar;
+class TabPlaceholder;
 class WebPage;
 class WebWindow;
 
@@ -62,6 +66,39 @@ public:
     WebWindow* currentWebWindow() const;
     WebWindow* webWindow(int index) const;
 
+    /**
+     * Restored tabs are just placeholders, loaded when they are
+     * activated (or preloaded, one at a time, if so configured).
+     * webWindow() returns NULL for them.
+     */
+    int addPlaceholderTab(const TabHistory &history);
+    TabPlaceholder *placeholder(int index) const;
+    WebWindow *loadPlaceholderTab(int index);
+
+    // These work for every tab, loaded or not
+    KUrl urlAt(int index) const;
+    QString titleAt(int index) const;
+
+    /**
+     * When rekonq uses more memory than configured (tabsMemoryBudget),
+     * the least recently activated tabs are discarded: they become placeholders
+     * and are reloaded on activation. Pinned, private and playing tabs are kept.
+     */
+    bool discardTab(int index);
+
+    // when the tab was activated last, in msecs since epoch
+    qint64 lastActivation(int index) const;
+
+    int discardedTabsCount() const
+    {
+        return _discardedTabs;
+    }
+
+    int reloadedTabsCount() const
+    {
+        return _reloadedTabs;
+    }
+
     TabBar* tabBar() const;
 
     bool isPrivateBrowsingWindowMode();
@@ -78,6 +115,11 @@ public:
 
     int insertTab(int index, QWidget *page, const QString &label);
     int insertTab(int index, QWidget *page, const QIcon &icon, const QString &label);
+
+    void moveTab(int from, int to);
+
+    // tabs are (un)pinned by the tab bar: journal it (see SessionManager::journalTabEvent)
+    void journalTabPinned(int index, bool pinned);
     // --------------------------------------------------------------------------------------
 
 public Q_SLOTS:
@@ -89,7 +131,12 @@ Q_SIGNALS:
     void closeWindow();
     void windowTitleChanged(QString);
     void actionsReady();
-    
+
+protected:
+    // journal the tab events (see SessionManager::journalTabEvent)
+    virtual void tabInserted(int index);
+    virtual void tabRemoved(int index);
+
 private:
     /**
      * Prepares the new WebWindow to be open
@@ -98,6 +145,10 @@ private:
 
     void init();
 
+    void replaceTab(int index, QWidget *tab);
+    void setTabFavicon(int index, const KUrl &url);
+    bool canDiscardTab(int index);
+
 private Q_SLOTS:
     /**
      * Updates new tab button position
@@ -115,6 +166,10 @@ private Q_SLOTS:
 
     void currentChanged(int);
 
+    void preloadNextTab();
+
+    void journalTabMove(int from, int to);
+
     // Indexed slots
     void cloneTab(int index = -1);
     void closeTab(int index = -1, bool del = true);
@@ -145,7 +200,17 @@ private:
 
     KActionCollection *_ac;
 
-    int _lastCurrentTabIndex;
+    QWeakPointer<WebWindow> _lastCurrentTab;
+
+    QList< QWeakPointer<TabPlaceholder> > _preloadQueue;
+    QWeakPointer<WebWindow> _preloadingTab;
+    int _preloadedTabs;
+
+    int _discardedTabs;
+    int _reloadedTabs;
+
+    bool _isReplacingTab;
+    bool _isMovingTab;
 };
 
 #endif // TAB_WIDGET
@@ -0,0 +1,175 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "sessionmanager.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QBuffer>
+#include <QtTest>
+
+
+class SessionJournalTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+
+    void replay();
+    void skipSnapshotEvents();
+    void newWindow();
+    void invalidIndexes();
+    void truncatedRecord();
+
+private:
+    QStringList urls(int window = 0) const;
+    void replay(const QByteArray &journal, quint32 snapshotSerial = 0);
+
+    QList<SessionWindow> m_session;
+};
+
+
+// a window with 3 tabs: a, b and c
+void SessionJournalTest::init()
+{
+    m_session.clear();
+
+    SessionWindow window;
+    window.name = QL1S("win1");
+    Q_FOREACH(const QString & url, QStringList() << "http://a/" << "http://b/" << "http://c/")
+    {
+        SessionTab tab;
+        tab.history.url = url;
+        window.tabs << tab;
+    }
+    m_session << window;
+}
+
+
+QStringList SessionJournalTest::urls(int window) const
+{
+    QStringList list;
+    Q_FOREACH(const SessionTab & tab, m_session.at(window).tabs)
+    {
+        list << tab.history.url;
+    }
+    return list;
+}
+
+
+void SessionJournalTest::replay(const QByteArray &journal, quint32 snapshotSerial)
+{
+    QByteArray data = journal;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    SessionManager::replayJournal(m_session, &buffer, snapshotSerial);
+}
+
+
+void SessionJournalTest::replay()
+{
+    QByteArray journal;
+    journal += SessionManager::journalRecord(1, SessionManager::TabAdded, QL1S("win1"), 1, QL1S("http://d/"));
+    journal += SessionManager::journalRecord(2, SessionManager::TabMoved, QL1S("win1"), 3, QString(), 0);
+    journal += SessionManager::journalRecord(3, SessionManager::TabPinned, QL1S("win1"), 0, QString(), 1);
+    journal += SessionManager::journalRecord(4, SessionManager::TabNavigated, QL1S("win1"), 2, QL1S("http://e/"));
+    journal += SessionManager::journalRecord(5, SessionManager::TabClosed, QL1S("win1"), 1);
+    replay(journal);
+
+    // a, d, b, c -> c, a, d, b -> c, a, e, b -> c, e, b
+    QCOMPARE(urls(), QStringList() << "http://c/" << "http://e/" << "http://b/");
+    QVERIFY(m_session.at(0).tabs.at(0).isPinned);
+    QVERIFY(!m_session.at(0).tabs.at(1).isPinned);
+
+    // the moved tab is pinned: unpin it
+    replay(SessionManager::journalRecord(6, SessionManager::TabPinned, QL1S("win1"), 0, QString(), 0));
+    QVERIFY(!m_session.at(0).tabs.at(0).isPinned);
+}
+
+
+void SessionJournalTest::skipSnapshotEvents()
+{
+    QByteArray journal;
+    journal += SessionManager::journalRecord(1, SessionManager::TabClosed, QL1S("win1"), 0);
+    journal += SessionManager::journalRecord(2, SessionManager::TabMoved, QL1S("win1"), 0, QString(), 2);
+    journal += SessionManager::journalRecord(3, SessionManager::TabNavigated, QL1S("win1"), 0, QL1S("http://d/"));
+    replay(journal, 2);
+
+    QCOMPARE(urls(), QStringList() << "http://d/" << "http://b/" << "http://c/");
+}
+
+
+void SessionJournalTest::newWindow()
+{
+    QByteArray journal;
+    journal += SessionManager::journalRecord(1, SessionManager::TabNavigated, QL1S("win2"), 0, QL1S("http://d/"));
+    journal += SessionManager::journalRecord(2, SessionManager::TabAdded, QL1S("win3"), 0, QL1S("http://e/"));
+    replay(journal);
+
+    QCOMPARE(m_session.count(), 2);
+    QCOMPARE(m_session.at(1).name, QString("win3"));
+    QCOMPARE(urls(1), QStringList() << "http://e/");
+    QCOMPARE(urls(0), QStringList() << "http://a/" << "http://b/" << "http://c/");
+}
+
+
+void SessionJournalTest::invalidIndexes()
+{
+    QByteArray journal;
+    journal += SessionManager::journalRecord(1, SessionManager::TabMoved, QL1S("win1"), 0, QString(), 3);
+    journal += SessionManager::journalRecord(2, SessionManager::TabMoved, QL1S("win1"), -1, QString(), 0);
+    journal += SessionManager::journalRecord(3, SessionManager::TabClosed, QL1S("win1"), 3);
+    journal += SessionManager::journalRecord(4, SessionManager::TabPinned, QL1S("win1"), 5, QString(), 1);
+    journal += SessionManager::journalRecord(5, SessionManager::TabAdded, QL1S("win1"), 10, QL1S("http://d/"));
+    replay(journal);
+
+    QCOMPARE(urls(), QStringList() << "http://a/" << "http://b/" << "http://c/" << "http://d/");
+}
+
+
+void SessionJournalTest::truncatedRecord()
+{
+    QByteArray journal = SessionManager::journalRecord(1, SessionManager::TabClosed, QL1S("win1"), 0);
+    const QByteArray last = SessionManager::journalRecord(2, SessionManager::TabClosed, QL1S("win1"), 0);
+    journal += last.left(last.size() / 2);
+    replay(journal);
+
+    QCOMPARE(urls(), QStringList() << "http://b/" << "http://c/");
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(SessionJournalTest, NoGUI)
+#include "sessionjournaltest.moc"
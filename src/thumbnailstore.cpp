@@ -0,0 +1,383 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+
+// Self Includes
+#include "thumbnailstore.h"
+#include "thumbnailstore.moc"
+
+// Auto Includes
+#include "rekonq.h"
+
+// Local Includes
+#include "autosaver.h"
+
+// KDE Includes
+#include <KSaveFile>
+#include <KStandardDirs>
+
+// Qt Includes
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QPixmap>
+#include <QUrl>
+
+#include <QtConcurrentRun>
+
+
+static const quint32 MANIFEST_VERSION = 1;
+
+
+QWeakPointer<ThumbnailStore> ThumbnailStore::s_thumbnailStore;
+
+
+ThumbnailStore *ThumbnailStore::self()
+{
+    if (s_thumbnailStore.isNull())
+    {
+        s_thumbnailStore = new ThumbnailStore(qApp);
+    }
+    return s_thumbnailStore.data();
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+ThumbnailStore::ThumbnailStore(QObject *parent)
+    : QObject(parent)
+    , m_totalSize(0)
+    , m_saveTimer(new AutoSaver(this))
+    , m_isQueueRunning(false)
+    , m_clearCount(0)
+{
+    m_thumbsDir = KStandardDirs::locateLocal("cache", QL1S("thumbs/"), true);
+
+    connect(m_saveTimer, SIGNAL(saveNeeded()), this, SLOT(saveManifest()));
+
+    loadManifest();
+}
+
+
+ThumbnailStore::~ThumbnailStore()
+{
+    // the thumbnails saved by now have to be in the manifest
+    m_queueFuture.waitForFinished();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+
+    m_saveTimer->saveIfNeccessary();
+}
+
+
+QString ThumbnailStore::fileName(const QUrl &url) const
+{
+    QByteArray name = url.toEncoded(QUrl::RemoveScheme | QUrl::RemoveUserInfo | QUrl::StripTrailingSlash);
+
+    return QString::fromLatin1(QCryptographicHash::hash(name, QCryptographicHash::Md5).toHex()) + QL1S(".png");
+}
+
+
+QString ThumbnailStore::thumbnailPath(const QUrl &url) const
+{
+    return m_thumbsDir + fileName(url);
+}
+
+
+QString ThumbnailStore::existingThumbnail(const QUrl &url)
+{
+    const QString name = fileName(url);
+
+    QHash<QString, Entry>::iterator it = m_entries.find(name);
+    if (it == m_entries.end())
+        return QString();
+
+    it->lastUsed = QDateTime::currentDateTime();
+    m_saveTimer->changeOccurred();
+
+    return m_thumbsDir + name;
+}
+
+
+void ThumbnailStore::saveThumbnail(const QUrl &url, const QPixmap &thumbnail)
+{
+    const QString name = fileName(url);
+    const QString path = m_thumbsDir + name;
+
+    QFile::remove(path);
+    if (!thumbnail.save(path))
+    {
+        kDebug() << "Unable to save thumbnail" << path;
+        return;
+    }
+
+    addThumbnail(name, QFileInfo(path).size());
+}
+
+
+void ThumbnailStore::queueThumbnail(const QUrl &url, const QImage &image, const QSize &size)
+{
+    if (image.isNull())
+        return;
+
+    QueuedThumbnail thumbnail;
+    thumbnail.image = image;
+    thumbnail.size = size;
+
+    const QString name = fileName(url);
+
+    QMutexLocker locker(&m_queueMutex);
+
+    if (!m_queuedThumbnails.contains(name))
+        m_queuedFiles << name;
+    m_queuedThumbnails.insert(name, thumbnail);
+
+    if (!m_isQueueRunning)
+    {
+        m_isQueueRunning = true;
+        m_queueFuture = QtConcurrent::run(saveQueuedThumbnails, this);
+    }
+}
+
+
+void ThumbnailStore::saveQueuedThumbnails(ThumbnailStore *store)
+{
+    Q_FOREVER
+    {
+        QString name;
+        QueuedThumbnail thumbnail;
+        int clearCount;
+        {
+            QMutexLocker locker(&store->m_queueMutex);
+            if (store->m_queuedFiles.isEmpty())
+            {
+                store->m_isQueueRunning = false;
+                return;
+            }
+            name = store->m_queuedFiles.takeFirst();
+            thumbnail = store->m_queuedThumbnails.take(name);
+            clearCount = store->m_clearCount;
+        }
+
+        const QString path = store->m_thumbsDir + name;
+        QImage image = thumbnail.image.scaled(thumbnail.size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+
+        QFile::remove(path);
+        if (!image.save(path, "PNG"))
+            continue;
+
+        // the manifest is updated in the main thread
+        QMetaObject::invokeMethod(store, "thumbnailWritten", Qt::QueuedConnection,
+                                  Q_ARG(QString, name), Q_ARG(qint64, QFileInfo(path).size()),
+                                  Q_ARG(int, clearCount));
+    }
+}
+
+
+void ThumbnailStore::thumbnailWritten(const QString &fileName, qint64 size, int clearCount)
+{
+    // queued before the thumbnails were cleared
+    if (clearCount != m_clearCount)
+    {
+        QFile::remove(m_thumbsDir + fileName);
+        return;
+    }
+
+    addThumbnail(fileName, size);
+}
+
+
+void ThumbnailStore::removeThumbnail(const QUrl &url)
+{
+    const QString name = fileName(url);
+
+    QFile::remove(m_thumbsDir + name);
+
+    if (m_entries.contains(name))
+    {
+        m_totalSize -= m_entries.take(name).size;
+        m_saveTimer->changeOccurred();
+    }
+}
+
+
+void ThumbnailStore::clearThumbnails()
+{
+    // the queued thumbnails go too, and the one being saved is dropped
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_queuedFiles.clear();
+        m_queuedThumbnails.clear();
+        m_clearCount++;
+    }
+
+    QDir thumbsDir(m_thumbsDir);
+    Q_FOREACH(const QString & name, thumbsDir.entryList(QDir::Files))
+    {
+        QFile::remove(m_thumbsDir + name);
+    }
+
+    m_entries.clear();
+    m_totalSize = 0;
+    m_saveTimer->changeOccurred();
+}
+
+
+void ThumbnailStore::addThumbnail(const QString &fileName, qint64 size)
+{
+    if (m_entries.contains(fileName))
+        m_totalSize -= m_entries.value(fileName).size;
+
+    Entry entry;
+    entry.size = size;
+    entry.lastUsed = QDateTime::currentDateTime();
+    m_entries.insert(fileName, entry);
+    m_totalSize += size;
+
+    evict();
+
+    m_saveTimer->changeOccurred();
+}
+
+
+void ThumbnailStore::evict()
+{
+    const qint64 budget = qint64(ReKonfig::thumbnailsDiskBudget()) * 1024 * 1024;
+    if (budget <= 0 || m_totalSize <= budget)
+        return;
+
+    // remove the least recently used ones, a bit more than needed:
+    // this won't happen again for the next few thumbnails
+    QMultiMap<QDateTime, QString> entriesByUse;
+    QHash<QString, Entry>::const_iterator it;
+    for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        entriesByUse.insert(it->lastUsed, it.key());
+
+    const qint64 target = budget * 9 / 10;
+    Q_FOREACH(const QString & name, entriesByUse)
+    {
+        if (m_totalSize <= target)
+            break;
+
+        QFile::remove(m_thumbsDir + name);
+        m_totalSize -= m_entries.take(name).size;
+    }
+}
+
+
+void ThumbnailStore::loadManifest()
+{
+    const QFileInfo manifestInfo(m_thumbsDir + QL1S("manifest"));
+    if (readManifest(manifestInfo.filePath()))
+    {
+        // thumbnails saved or removed after the manifest (e.g. rekonq crashed
+        // before saving it) changed the directory: look at them, too
+        if (QFileInfo(m_thumbsDir).lastModified() <= manifestInfo.lastModified())
+            return;
+
+        kDebug() << "Thumbnails manifest is older than the thumbnails: checking them";
+    }
+
+    // the thumbnails on disk, with the last use known for them (if any)
+    QHash<QString, Entry> entries;
+    m_totalSize = 0;
+
+    QDir thumbsDir(m_thumbsDir);
+    Q_FOREACH(const QFileInfo & info, thumbsDir.entryInfoList(QStringList() << QL1S("*.png"), QDir::Files))
+    {
+        Entry entry;
+        entry.size = info.size();
+
+        QHash<QString, Entry>::const_iterator it = m_entries.constFind(info.fileName());
+        entry.lastUsed = (it != m_entries.constEnd()) ? it->lastUsed : info.lastModified();
+
+        entries.insert(info.fileName(), entry);
+        m_totalSize += entry.size;
+    }
+    m_entries = entries;
+
+    evict();
+    m_saveTimer->changeOccurred();
+}
+
+
+bool ThumbnailStore::readManifest(const QString &filePath)
+{
+    QFile manifest(filePath);
+    if (!manifest.open(QFile::ReadOnly))
+        return false;
+
+    QDataStream in(&manifest);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 version = 0;
+    qint32 count = 0;
+    in >> version >> count;
+
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        QString name;
+        Entry entry;
+        in >> name >> entry.size >> entry.lastUsed;
+        m_entries.insert(name, entry);
+        m_totalSize += entry.size;
+    }
+
+    if (version == MANIFEST_VERSION && in.status() == QDataStream::Ok)
+        return true;
+
+    kDebug() << "Unable to read thumbnails manifest" << manifest.fileName();
+    m_entries.clear();
+    m_totalSize = 0;
+    return false;
+}
+
+
+void ThumbnailStore::saveManifest()
+{
+    KSaveFile manifest(m_thumbsDir + QL1S("manifest"));
+    if (!manifest.open(QFile::WriteOnly))
+    {
+        kDebug() << "Unable to open thumbnails manifest" << manifest.fileName();
+        return;
+    }
+
+    QDataStream out(&manifest);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    out << MANIFEST_VERSION << qint32(m_entries.count());
+
+    QHash<QString, Entry>::const_iterator it;
+    for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        out << it.key() << it->size << it->lastUsed;
+
+    if (!manifest.finalize())
+        kDebug() << "Unable to write thumbnails manifest" << manifest.fileName() << manifest.errorString();
+}
@@ -0,0 +1,153 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+
+#ifndef THUMBNAIL_STORE_H
+#define THUMBNAIL_STORE_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Qt Includes
+#include <QDateTime>
+#include <QFuture>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+#include <QWeakPointer>
+
+// Forward Declarations
+class AutoSaver;
+
+class QPixmap;
+class QUrl;
+
+
+/**
+ * The site thumbnails (the "previews" of the new tab page), saved as PNG
+ * files in the cache. Their manifest (file, size, last use) is kept in memory,
+ * so no disk access is needed to know if a thumbnail exists.
+ *
+ * The thumbnails use no more than thumbnailsDiskBudget MB:
+ * the least recently used ones are removed.
+ *
+ */
+class REKONQ_TESTS_EXPORT ThumbnailStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Entry point.
+     * Access to ThumbnailStore class by using
+     * ThumbnailStore::self()->thePublicMethodYouNeed()
+     */
+    static ThumbnailStore *self();
+
+    ~ThumbnailStore();
+
+    /**
+     * @return the local path of the url thumbnail, existing or not
+     */
+    QString thumbnailPath(const QUrl &url) const;
+
+    /**
+     * @return the local path of the url thumbnail, or an empty string if there is none.
+     * This also marks the thumbnail as used.
+     */
+    QString existingThumbnail(const QUrl &url);
+
+    /**
+     * Saves now the url thumbnail
+     */
+    void saveThumbnail(const QUrl &url, const QPixmap &thumbnail);
+
+    /**
+     * Scales the image to size && saves it as the url thumbnail, in a worker thread.
+     * Just the last image queued for an url is saved.
+     */
+    void queueThumbnail(const QUrl &url, const QImage &image, const QSize &size);
+
+    void removeThumbnail(const QUrl &url);
+
+    void clearThumbnails();
+
+private:
+    explicit ThumbnailStore(QObject *parent = 0);
+
+    QString fileName(const QUrl &url) const;
+
+    void loadManifest();
+    bool readManifest(const QString &filePath);
+    void addThumbnail(const QString &fileName, qint64 size);
+    void evict();
+
+    // NOTE: this runs in a worker thread
+    static void saveQueuedThumbnails(ThumbnailStore *store);
+
+private Q_SLOTS:
+    void thumbnailWritten(const QString &fileName, qint64 size, int clearCount);
+    void saveManifest();
+
+private:
+    struct Entry
+    {
+        qint64 size;
+        QDateTime lastUsed;
+    };
+
+    QString m_thumbsDir;
+
+    QHash<QString, Entry> m_entries;
+    qint64 m_totalSize;
+
+    AutoSaver *m_saveTimer;
+
+    // the thumbnails waiting to be scaled && saved, by file name
+    struct QueuedThumbnail
+    {
+        QImage image;
+        QSize size;
+    };
+
+    QMutex m_queueMutex;
+    QStringList m_queuedFiles;
+    QHash<QString, QueuedThumbnail> m_queuedThumbnails;
+    bool m_isQueueRunning;
+    QFuture<void> m_queueFuture;
+
+    // bumped by clearThumbnails(), under the queue mutex
+    int m_clearCount;
+
+    static QWeakPointer<ThumbnailStore> s_thumbnailStore;
+};
+
+
+#endif // THUMBNAIL_STORE_H
@@ -31,6 +31,9 @@
 // Auto Includes
 #include "rekonq.h"
 
+// Local Includes
+#include "adblockmanager.h"
+
 // KDE Includes
 #include <KDialogButtonBox>
 #include <KIcon>
@@ -109,19 +112,7 @@ void AdBlockWidget::accept()
     bool on = _chBox->isChecked();
     if (on != _isAdblockEnabledHere)
     {
-        QStringList hosts = ReKonfig::whiteReferer();
-
-        if (on)
-        {
-            kDebug() << "REMOVING IT...";
-            hosts.removeOne(_pageUrl.host());
-        }
-        else
-        {
-            hosts << _pageUrl.host();
-        }
-
-        ReKonfig::setWhiteReferer(hosts);
+        AdBlockManager::self()->setAdblockEnabledForSite(_pageUrl.host(), on);
 
         emit updateIcon();
     }
@@ -51,13 +51,24 @@
 #include <QVBoxLayout>
 #include <QKeyEvent>
 
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+
+// NOTE: this runs in a worker thread
+static UrlSuggester *computeSlowSuggestions(UrlSuggester *suggester)
+{
+    suggester->computeSlowSuggestions();
+    return suggester;
+}
+
 
 
 CompletionWidget::CompletionWidget(QWidget *parent)
     : QFrame(parent, Qt::ToolTip)
     , _parent(parent)
     , _currentIndex(0)
-    , _hasSuggestions(false)
+    , _suggestionsGeneration(0)
 {
     setFrameStyle(QFrame::Panel);
     setLayoutDirection(Qt::LeftToRight);
@@ -68,40 +79,103 @@ CompletionWidget::CompletionWidget(QWidget *parent)
 }
 
 
+CompletionWidget::~CompletionWidget()
+{
+    // the suggesters still computing belong to us: wait for them
+    Q_FOREACH(SuggestionsWatcher * watcher, _suggestionsWatchers)
+    {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+        delete watcher->result();
+        delete watcher;
+    }
+}
+
+
 void CompletionWidget::insertItems(const UrlSuggestionList &list, const QString& text, int offset)
 {
+    QVBoxLayout *vLayout = static_cast<QVBoxLayout *>(layout());
+
     Q_FOREACH(const UrlSuggestionItem & item, list)
     {
-        ListItem *suggestion = ListItemFactory::create(item, text, this);
-        suggestion->setBackgroundRole(offset % 2 ? QPalette::AlternateBase : QPalette::Base);
+        ListItem *suggestion = offset < _items.count() ? _items.at(offset) : 0;
 
-        connect(suggestion,
-                SIGNAL(itemClicked(ListItem*,Qt::MouseButton,Qt::KeyboardModifiers)),
-                this,
-                SLOT(itemChosen(ListItem*,Qt::MouseButton,Qt::KeyboardModifiers)));
+        // NOTE: rows are recycled: just update the text when the kind of row matches
+        if (!suggestion || !ListItemFactory::reuse(suggestion, item, text))
+        {
+            if (suggestion)
+            {
+                vLayout->removeWidget(suggestion);
+                suggestion->hide();
+                suggestion->deleteLater();
+            }
 
-        connect(this, SIGNAL(nextItemSubChoice()), suggestion, SLOT(nextItemSubChoice()));
+            suggestion = ListItemFactory::create(item, text, this);
+            suggestion->setBackgroundRole(offset % 2 ? QPalette::AlternateBase : QPalette::Base);
 
-        suggestion->setObjectName(QString::number(offset++));
-        layout()->addWidget(suggestion);
+            connect(suggestion,
+                    SIGNAL(itemClicked(ListItem*,Qt::MouseButton,Qt::KeyboardModifiers)),
+                    this,
+                    SLOT(itemChosen(ListItem*,Qt::MouseButton,Qt::KeyboardModifiers)));
+
+            connect(this, SIGNAL(nextItemSubChoice()), suggestion, SLOT(nextItemSubChoice()));
+
+            vLayout->insertWidget(offset, suggestion);
+            if (offset < _items.count())
+                _items[offset] = suggestion;
+            else
+                _items.append(suggestion);
+        }
+
+        suggestion->show();
+        ++offset;
     }
+
+    // hide the rows not needed now
+    for (int i = offset; i < _items.count(); ++i)
+        _items.at(i)->hide();
+}
+
+
+ListItem *CompletionWidget::listItem(int index) const
+{
+    if (index < 0 || index >= _list.count() || index >= _items.count())
+        return 0;
+
+    return _items.at(index);
 }
 
 
 void CompletionWidget::updateSuggestionList(const UrlSuggestionList &list, const QString& text)
-{    
-    if (_hasSuggestions || _typedString != text)
+{
+    if (_typedString != text)
         return;
-    _hasSuggestions = true;
 
     if (list.count() > 0)
     {
+        // history & bookmarks suggestions come later:
+        // stay on the suggestion the user moved to, if it's still there
+        QString currentUrl;
+        if (_currentIndex > 0 && _currentIndex < _list.count())
+            currentUrl = _list.at(_currentIndex).url;
+
         clear();
 
         insertItems(list, text);
         _list = list;
 
         popup();
+
+        for (int i = 1; !currentUrl.isEmpty() && i < _list.count(); ++i)
+        {
+            if (_list.at(i).url == currentUrl)
+            {
+                listItem(0)->deactivate();
+                _currentIndex = i;
+                activateCurrentListItem();
+                break;
+            }
+        }
     }
 }
 
@@ -111,10 +185,9 @@ void CompletionWidget::sizeAndPosition()
     setFixedWidth(_parent->width());
 
     int h = 0;
-    for (int i = 0; i < layout()->count(); i++)
+    for (int i = 0; i < _list.count(); i++)
     {
-        QWidget *widget = layout()->itemAt(i)->widget();
-        h += widget->sizeHint().height();
+        h += _items.at(i)->sizeHint().height();
     }
     setFixedSize(_parent->width(), h + 5);
 
@@ -126,7 +199,7 @@ void CompletionWidget::sizeAndPosition()
 
 void CompletionWidget::popup()
 {
-    findChild<ListItem *>(QString::number(0))->activate(); //activate first listitem
+    listItem(0)->activate(); //activate first listitem
     sizeAndPosition();
     if (!isVisible())
         show();
@@ -136,7 +209,7 @@ void CompletionWidget::popup()
 void CompletionWidget::up()
 {
     if (_currentIndex >= 0)
-        findChild<ListItem *>(QString::number(_currentIndex))->deactivate(); // deactivate previous
+        listItem(_currentIndex)->deactivate(); // deactivate previous
 
     --_currentIndex;
     if (_currentIndex < -1)
@@ -151,7 +224,7 @@ void CompletionWidget::up()
 void CompletionWidget::down()
 {
     if (_currentIndex >= 0)
-        findChild<ListItem *>(QString::number(_currentIndex))->deactivate(); // deactivate previous
+        listItem(_currentIndex)->deactivate(); // deactivate previous
 
     ++_currentIndex;
     if (_currentIndex == _list.count())
@@ -166,7 +239,7 @@ void CompletionWidget::activateCurrentListItem()
     UrlBar *bar = qobject_cast<UrlBar *>(_parent);
 
     // activate "new" current
-    ListItem *widget = findChild<ListItem *>(QString::number(_currentIndex));
+    ListItem *widget = listItem(_currentIndex);
 
     // update text of the url bar
     bar->blockSignals(true); // without compute suggestions
@@ -187,14 +260,14 @@ void CompletionWidget::activateCurrentListItem()
 
 void CompletionWidget::clear()
 {
-    QLayoutItem *child;
-    while ((child = layout()->takeAt(0)) != 0)
+    // keep the rows around: next suggestions will reuse them
+    for (int i = 0; i < _list.count() && i < _items.count(); ++i)
     {
-        child->widget()->deleteLater();
-        delete child;
+        _items.at(i)->deactivate();
+        _items.at(i)->hide();
     }
+    _list.clear();
     _currentIndex = 0;
-    _hasSuggestions = false;
 }
 
 
@@ -287,7 +360,7 @@ bool CompletionWidget::eventFilter(QObject *obj, QEvent *ev)
 
                 if (_currentIndex == -1)
                     _currentIndex = 0;
-                child = findChild<ListItem *>(QString::number(_currentIndex));
+                child = listItem(_currentIndex);
 
                 if (child) //the completionwidget is visible and the user had press down
                 {
@@ -342,6 +415,9 @@ void CompletionWidget::setVisible(bool visible)
     {
         qApp->removeEventFilter(this);
         clear();
+
+        // no more suggestions to wait for
+        ++_suggestionsGeneration;
     }
 
     QFrame::setVisible(visible);
@@ -369,6 +445,7 @@ void CompletionWidget::itemChosen(ListItem *item, Qt::MouseButton button, Qt::Ke
 void CompletionWidget::suggestUrls(const QString &text)
 {
     _typedString = text;
+    ++_suggestionsGeneration;
 
     QWidget *w = qobject_cast<QWidget *>(parent());
     if (!w->hasFocus())
@@ -380,12 +457,41 @@ void CompletionWidget::suggestUrls(const QString &text)
         return;
     }
 
+    // browse & search suggestions are cheap: show them now
     UrlSuggester *res = new UrlSuggester(text);
-    UrlSuggestionList list = res->computeSuggestions();
+    UrlSuggestionList list = res->computeFastSuggestions();
 
     updateSuggestionList(list, text);
 
+    if (!res->hasSlowSuggestions())
+    {
+        delete res;
+        return;
+    }
+
+    // ...and look for history & bookmarks in a worker thread
+    SuggestionsWatcher *watcher = new SuggestionsWatcher(this);
+    watcher->setProperty("generation", _suggestionsGeneration);
+    _suggestionsWatchers.append(watcher);
+    connect(watcher, SIGNAL(finished()), this, SLOT(slowSuggestionsReady()));
+    watcher->setFuture(QtConcurrent::run(computeSlowSuggestions, res));
+}
+
+
+void CompletionWidget::slowSuggestionsReady()
+{
+    SuggestionsWatcher *watcher = static_cast<SuggestionsWatcher *>(sender());
+    _suggestionsWatchers.removeOne(watcher);
+
+    UrlSuggester *res = watcher->result();
+
+    // NOTE: a watcher of the current generation computed the suggestions
+    // for _typedString, as typed (the suggester one is trimmed)
+    if (watcher->property("generation").toInt() == _suggestionsGeneration)
+        updateSuggestionList(res->orderLists(), _typedString);
+
     delete res;
+    watcher->deleteLater();
 }
 
 
@@ -395,7 +501,7 @@ KUrl CompletionWidget::activeSuggestion()
     if (_currentIndex == -1)
         index = 0;
 
-    ListItem *child = findChild<ListItem *>(QString::number(index));
+    ListItem *child = listItem(index);
     if (child)
         return child->url();
 
@@ -39,6 +39,7 @@
 
 // Qt Includes
 #include <QFrame>
+#include <QFutureWatcher>
 
 // Forward Declarations
 class ListItem;
@@ -50,6 +51,7 @@ class CompletionWidget : public QFrame
 
 public:
     explicit CompletionWidget(QWidget *parent);
+    ~CompletionWidget();
 
     virtual bool eventFilter(QObject *obj, QEvent *ev);
     void setVisible(bool visible);
@@ -61,6 +63,7 @@ public:
 private Q_SLOTS:
     void itemChosen(ListItem *item, Qt::MouseButton = Qt::LeftButton, Qt::KeyboardModifiers = Qt::NoModifier);
     void updateSuggestionList(const UrlSuggestionList &list, const QString& text);
+    void slowSuggestionsReady();
 
 Q_SIGNALS:
     void chosenUrl(const KUrl &, Rekonq::OpenType);
@@ -68,6 +71,7 @@ Q_SIGNALS:
 
 private:
     void insertItems(const UrlSuggestionList &list, const QString& text, int offset = 0);
+    ListItem *listItem(int index) const;
 
     void popup();
     void clear();
@@ -81,12 +85,23 @@ private:
 
     UrlSuggestionList _list;
 
+    // popup rows, recycled between suggestions:
+    // the first _list.count() are the shown ones
+    QList<ListItem *> _items;
+
     int _currentIndex;
 
     KService::Ptr _searchEngine;
 
     QString _typedString;
-    bool _hasSuggestions;
+
+    // bumped on every typed text: suggestions computed
+    // for a previous one are just dropped
+    int _suggestionsGeneration;
+
+    // slow suggestions still being computed
+    typedef QFutureWatcher<UrlSuggester *> SuggestionsWatcher;
+    QList<SuggestionsWatcher *> _suggestionsWatchers;
 };
 
 #endif // COMPLETION_WIDGET_H
@@ -150,6 +150,18 @@ QString ListItem::text()
 }
 
 
+void ListItem::setItem(const UrlSuggestionItem &item, const QString &text)
+{
+    Q_UNUSED(text);
+
+    m_url = item.url;
+
+    // a recycled row starts like a new one: not hovered, nor selected
+    m_option.state &= ~QStyle::State_MouseOver;
+    deactivate();
+}
+
+
 void ListItem::nextItemSubChoice()
 {
     // will be override
@@ -161,6 +173,7 @@ void ListItem::nextItemSubChoice()
 
 TypeIconLabel::TypeIconLabel(int type, QWidget *parent)
     : QLabel(parent)
+    , m_type(-1)
 {
     setMinimumWidth(16);
     QHBoxLayout *hLayout = new QHBoxLayout;
@@ -168,14 +181,32 @@ TypeIconLabel::TypeIconLabel(int type, QWidget *parent)
     hLayout->setAlignment(Qt::AlignRight);
     setLayout(hLayout);
 
+    setType(type);
+}
+
+
+void TypeIconLabel::setType(int type)
+{
+    if (type == m_type)
+        return;
+
+    m_type = type;
+
+    QLayoutItem *child;
+    while ((child = layout()->takeAt(0)) != 0)
+    {
+        delete child->widget();
+        delete child;
+    }
+
     if (type & UrlSuggestionItem::Search)
-        hLayout->addWidget(getIcon("edit-find"));
+        layout()->addWidget(getIcon("edit-find"));
     if (type & UrlSuggestionItem::Browse)
-        hLayout->addWidget(getIcon("applications-internet"));
+        layout()->addWidget(getIcon("applications-internet"));
     if (type & UrlSuggestionItem::Bookmark)
-        hLayout->addWidget(getIcon("rating"));
+        layout()->addWidget(getIcon("rating"));
     if (type & UrlSuggestionItem::History)
-        hLayout->addWidget(getIcon("view-history"));
+        layout()->addWidget(getIcon("view-history"));
 }
 
 
@@ -244,16 +275,7 @@ TextLabel::TextLabel(const QString &text, const QString &textToPointOut, QWidget
 {
     setTextFormat(Qt::RichText);
     setMouseTracking(false);
-    QString t = text;
-    const bool wasItalic = t.startsWith(QL1S("<i>"));
-    if (wasItalic)
-        t.remove(QRegExp(QL1S("<[/ib]*>")));
-    t = Qt::escape(t);
-    QStringList words = Qt::escape(textToPointOut.simplified()).split(QL1C(' '));
-    t = highlightWordsInText(t, words);
-    if (wasItalic)
-        t = QL1S("<i style=color:\"#555\">") + t + QL1S("</i>");
-    setText(t);
+    setHighlightedText(text, textToPointOut);
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Maximum);
 }
 
@@ -267,6 +289,21 @@ TextLabel::TextLabel(QWidget *parent)
 }
 
 
+void TextLabel::setHighlightedText(const QString &text, const QString &textToPointOut)
+{
+    QString t = text;
+    const bool wasItalic = t.startsWith(QL1S("<i>"));
+    if (wasItalic)
+        t.remove(QRegExp(QL1S("<[/ib]*>")));
+    t = Qt::escape(t);
+    QStringList words = Qt::escape(textToPointOut.simplified()).split(QL1C(' '));
+    t = highlightWordsInText(t, words);
+    if (wasItalic)
+        t = QL1S("<i style=color:\"#555\">") + t + QL1S("</i>");
+    setText(t);
+}
+
+
 void TextLabel::setEngineText(const QString &engine, const QString &text)
 {
     setText(i18nc("%1=search engine, e.g. Google, Wikipedia %2=text to search for", "Search %1 for <b>%2</b>", engine, Qt::escape(text)));
@@ -283,12 +320,31 @@ PreviewListItem::PreviewListItem(const UrlSuggestionItem &item, const QString &t
     hLayout->setSpacing(4);
 
     // icon
-    hLayout->addWidget(new TypeIconLabel(item.type, this));
+    m_typeIcon = new TypeIconLabel(item.type, this);
+    hLayout->addWidget(m_typeIcon);
 
     // url + text
     QVBoxLayout *vLayout = new QVBoxLayout;
     vLayout->setMargin(0);
 
+    m_titleLabel = new TextLabel(this);
+    m_urlLabel = new TextLabel(this);
+    vLayout->addWidget(m_titleLabel);
+    vLayout->addWidget(m_urlLabel);
+    hLayout->addLayout(vLayout);
+
+    setLayout(hLayout);
+
+    setItem(item, text);
+}
+
+
+void PreviewListItem::setItem(const UrlSuggestionItem &item, const QString &text)
+{
+    ListItem::setItem(item, text);
+
+    m_typeIcon->setType(item.type);
+
     QString title = item.title;
     if (title.isEmpty())
     {
@@ -297,11 +353,8 @@ PreviewListItem::PreviewListItem(const UrlSuggestionItem &item, const QString &t
         title.truncate(title.indexOf("/"));
     }
 
-    vLayout->addWidget(new TextLabel(title, text, this));
-    vLayout->addWidget(new TextLabel("<i>" + item.url + "</i>", text, this));
-    hLayout->addLayout(vLayout);
-
-    setLayout(hLayout);
+    m_titleLabel->setHighlightedText(title, text);
+    m_urlLabel->setHighlightedText("<i>" + item.url + "</i>", text);
 }
 
 
@@ -321,10 +374,12 @@ SearchListItem::SearchListItem(const UrlSuggestionItem &item, const QString &tex
 
     m_engineBar = new EngineBar(engine, parent);
 
+    m_typeIcon = new TypeIconLabel(item.type, this);
+
     QHBoxLayout *hLayout = new QHBoxLayout;
     hLayout->setSpacing(4);
 
-    hLayout->addWidget(new TypeIconLabel(item.type, this));
+    hLayout->addWidget(m_typeIcon);
     hLayout->addWidget(m_titleLabel);
     hLayout->addWidget(new QLabel(i18n("Engines:"), this));
     hLayout->addWidget(m_engineBar);
@@ -341,6 +396,22 @@ QString SearchListItem::text()
 }
 
 
+void SearchListItem::setItem(const UrlSuggestionItem &item, const QString &text)
+{
+    ListItem::setItem(item, text);
+
+    m_text = text;
+    m_typeIcon->setType(item.type);
+    m_titleLabel->setEngineText(item.description, item.title);
+
+    KService::Ptr engine = SearchEngine::fromString(text);
+    if (!engine)
+        engine = SearchEngine::defaultEngine();
+
+    m_engineBar->setSelectedEngine(engine);
+}
+
+
 void SearchListItem::changeSearchEngine(KService::Ptr engine)
 {
     // NOTE: This to let rekonq loading text typed in the requested engine on click.
@@ -420,6 +491,22 @@ void EngineBar::changeSearchEngine()
 }
 
 
+void EngineBar::setSelectedEngine(KService::Ptr engine)
+{
+    if (!engine)
+        return;
+
+    Q_FOREACH(QAction * a, m_engineGroup->actions())
+    {
+        if (a->data().toString() == engine->entryPath())
+        {
+            a->setChecked(true);
+            return;
+        }
+    }
+}
+
+
 void EngineBar::selectNextEngine()
 {
     QList<QAction *> e = m_engineGroup->actions();
@@ -451,16 +538,49 @@ BrowseListItem::BrowseListItem(const UrlSuggestionItem &item, const QString &tex
     QHBoxLayout *hLayout = new QHBoxLayout;
     hLayout->setSpacing(4);
 
-    hLayout->addWidget(new TypeIconLabel(item.type, this));
-    hLayout->addWidget(new TextLabel(item.url, text, this));
+    m_typeIcon = new TypeIconLabel(item.type, this);
+    m_urlLabel = new TextLabel(item.url, text, this);
+    hLayout->addWidget(m_typeIcon);
+    hLayout->addWidget(m_urlLabel);
 
     setLayout(hLayout);
 }
 
 
+void BrowseListItem::setItem(const UrlSuggestionItem &item, const QString &text)
+{
+    ListItem::setItem(item, text);
+
+    m_typeIcon->setType(item.type);
+    m_urlLabel->setHighlightedText(item.url, text);
+}
+
+
 // ---------------------------------------------------------------
 
 
+const QMetaObject *ListItemFactory::itemClass(const UrlSuggestionItem &item)
+{
+    if (item.type & UrlSuggestionItem::Search)
+        return &SearchListItem::staticMetaObject;
+
+    if (item.type & UrlSuggestionItem::Browse)
+        return &BrowseListItem::staticMetaObject;
+
+    return &PreviewListItem::staticMetaObject;
+}
+
+
+bool ListItemFactory::reuse(ListItem *listItem, const UrlSuggestionItem &item, const QString &text)
+{
+    if (listItem->metaObject() != itemClass(item))
+        return false;
+
+    listItem->setItem(item, text);
+    return true;
+}
+
+
 ListItem *ListItemFactory::create(const UrlSuggestionItem &item, const QString &text, QWidget *parent)
 {
     if (item.type & UrlSuggestionItem::Search)
@@ -67,6 +67,14 @@ public:
     KUrl url();
     virtual QString text();
 
+    /**
+     * Shows another suggestion in this (already built) item.
+     * Items are recycled by the completion popup: subclasses
+     * just update their labels here.
+     *
+     */
+    virtual void setItem(const UrlSuggestionItem &item, const QString &text);
+
 public Q_SLOTS:
     virtual void nextItemSubChoice();
 
@@ -96,9 +104,13 @@ class REKONQ_TESTS_EXPORT TypeIconLabel : public QLabel
 
 public:
     explicit TypeIconLabel(int type, QWidget *parent = 0);
-    
+
+    void setType(int type);
+
 private:
     QLabel *getIcon(QString icon);
+
+    int m_type;
 };
 
 
@@ -112,7 +124,8 @@ class REKONQ_TESTS_EXPORT TextLabel : public QLabel
 public:
     explicit TextLabel(const QString &text, const QString &textToPointOut = QString(), QWidget *parent = 0);
     explicit TextLabel(QWidget *parent = 0);
-    
+
+    void setHighlightedText(const QString &text, const QString &textToPointOut);
     void setEngineText(const QString &engine, const QString &text);
 };
 
@@ -126,8 +139,9 @@ class REKONQ_TESTS_EXPORT EngineBar : public KToolBar
 
 public:
     explicit EngineBar(KService::Ptr selectedEngine, QWidget *parent = 0);
-    
+
     void selectNextEngine();
+    void setSelectedEngine(KService::Ptr engine);
 
 Q_SIGNALS:
     void searchEngineChanged(KService::Ptr engine);
@@ -151,8 +165,9 @@ class REKONQ_TESTS_EXPORT SearchListItem : public ListItem
 
 public:
     explicit SearchListItem(const UrlSuggestionItem &item, const QString &text, QWidget *parent = 0);
-    
+
     QString text();
+    void setItem(const UrlSuggestionItem &item, const QString &text);
 
 public Q_SLOTS:
     virtual void nextItemSubChoice();
@@ -161,6 +176,7 @@ private Q_SLOTS:
     void changeSearchEngine(KService::Ptr engine);
 
 private:
+    TypeIconLabel* m_typeIcon;
     TextLabel* m_titleLabel;
     EngineBar* m_engineBar;
     QString m_text;
@@ -177,6 +193,13 @@ class REKONQ_TESTS_EXPORT PreviewListItem : public ListItem
 
 public:
     PreviewListItem(const UrlSuggestionItem &item, const QString &text, QWidget *parent = 0);
+
+    void setItem(const UrlSuggestionItem &item, const QString &text);
+
+private:
+    TypeIconLabel *m_typeIcon;
+    TextLabel *m_titleLabel;
+    TextLabel *m_urlLabel;
 };
 
 
@@ -189,6 +212,12 @@ class REKONQ_TESTS_EXPORT BrowseListItem : public ListItem
 
 public:
     BrowseListItem(const UrlSuggestionItem &item, const QString &text, QWidget *parent = 0);
+
+    void setItem(const UrlSuggestionItem &item, const QString &text);
+
+private:
+    TypeIconLabel *m_typeIcon;
+    TextLabel *m_urlLabel;
 };
 
 
@@ -199,6 +228,16 @@ class REKONQ_TESTS_EXPORT ListItemFactory
 {
 public:
     static ListItem *create(const UrlSuggestionItem &item, const QString &text, QWidget *parent);
+
+    /**
+     * Shows item in the recycled one, when it is of the right kind.
+     * Returns false if a new item has to be created instead.
+     *
+     */
+    static bool reuse(ListItem *listItem, const UrlSuggestionItem &item, const QString &text);
+
+private:
+    static const QMetaObject *itemClass(const UrlSuggestionItem &item);
 };
 
 
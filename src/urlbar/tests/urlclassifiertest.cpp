@@ -0,0 +1,128 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Local Includes
+#include "urlclassifier.h"
+
+// KDE Includes
+#include <qtest_kde.h>
+
+// Qt Includes
+#include <QtTest>
+
+
+class UrlClassifierTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void isBrowsable_data();
+    void isBrowsable();
+
+    void startsWithIpAddress_data();
+    void startsWithIpAddress();
+};
+
+
+void UrlClassifierTest::isBrowsable_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("browsable");
+
+    QTest::newRow("path") << "/home/user/file.txt" << true;
+    QTest::newRow("localhost") << "localhost" << true;
+    QTest::newRow("localhost port") << "localhost:8080" << true;
+    QTest::newRow("localhost path") << "localhost/index.html" << true;
+    QTest::newRow("not localhost") << "localhosts" << false;
+    QTest::newRow("protocol") << "http://rekonq" << true;
+    QTest::newRow("javascript") << "javascript:void(0)" << true;
+    QTest::newRow("unknown protocol") << "rekonq:kde" << false;
+    QTest::newRow("address") << "kde.org" << true;
+    QTest::newRow("upper case address") << "WWW.KDE.ORG" << true;
+    QTest::newRow("subdomains") << "rekonq.kde.org" << true;
+    QTest::newRow("address with path") << "kde.org/announcements" << true;
+    QTest::newRow("country domain") << "www.kde.it" << true;
+    QTest::newRow("unknown domain") << "rekonq.kde" << false;
+    QTest::newRow("no host") << ".org" << false;
+    QTest::newRow("ipv4") << "192.168.0.1" << true;
+    QTest::newRow("ipv4 port") << "127.0.0.1:8080" << true;
+    QTest::newRow("ipv6") << "[::1]:8080" << true;
+    QTest::newRow("word") << "rekonq" << false;
+    QTest::newRow("words") << "rekonq web browser" << false;
+    QTest::newRow("number") << "3.14" << false;
+    QTest::newRow("empty") << "" << false;
+}
+
+
+void UrlClassifierTest::isBrowsable()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, browsable);
+
+    QCOMPARE(UrlClassifier::isBrowsable(text), browsable);
+}
+
+
+void UrlClassifierTest::startsWithIpAddress_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("address");
+
+    QTest::newRow("ipv4") << "10.0.0.138" << true;
+    QTest::newRow("ipv4 leading zeros") << "010.000.000.001" << true;
+    QTest::newRow("ipv4 path") << "10.0.0.1/admin" << true;
+    QTest::newRow("ipv4 out of range") << "192.168.0.256" << false;
+    QTest::newRow("ipv4 long number") << "1.2.3.4567" << false;
+    QTest::newRow("ipv4 missing part") << "1.2.3" << false;
+    QTest::newRow("ipv6") << "2001:db8:85a3:0:0:8a2e:370:7334" << true;
+    QTest::newRow("ipv6 compressed") << "fe80::1" << true;
+    QTest::newRow("ipv6 loopback") << "::1" << true;
+    QTest::newRow("ipv6 brackets") << "[2001:db8::7334]" << true;
+    QTest::newRow("ipv6 missing groups") << "1:2:3" << false;
+    QTest::newRow("ipv6 two compressions") << "1::2::3" << false;
+    QTest::newRow("ipv6 long group") << "12345::1" << false;
+    QTest::newRow("ipv6 trailing colon") << "1:2:3:4:5:6:7:" << false;
+    QTest::newRow("text") << "rekonq" << false;
+}
+
+
+void UrlClassifierTest::startsWithIpAddress()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, address);
+
+    QCOMPARE(UrlClassifier::startsWithIpAddress(text), address);
+}
+
+
+// ----------------------------------------------------------------------------------------------
+
+
+QTEST_KDEMAIN(UrlClassifierTest, NoGUI)
+#include "urlclassifiertest.moc"
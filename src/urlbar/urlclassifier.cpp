@@ -0,0 +1,250 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+
+// Self Includes
+#include "urlclassifier.h"
+
+// KDE Includes
+#include <KGlobal>
+#include <KProtocolInfo>
+
+// Qt Includes
+#include <QSet>
+#include <QStringList>
+
+
+// NOTE
+// the top level domains we know: the old browse regexp ones
+static const char TOP_LEVEL_DOMAINS[] =
+    "ac ad ae af ag ai al am an ao aq ar as at au aw az "
+    "ba bb bd be bf bg bh bi bj bm bn bo br bs bt bv bw by bz "
+    "ca cc cd cf cg ch ci ck cl cm cn co cr cu cv cx cy cz "
+    "de dj dk dm dn do dz "
+    "ec ee eg eh er es et eu "
+    "fi fj fk fm fn fo fr "
+    "ga gb gd ge gf gg gh gi gl gm gn gp gq gr gs gt gu gw gy "
+    "hk hm hn hr ht hu "
+    "id ie il im in io iq ir is it "
+    "je jm jo jp "
+    "ke kg kh ki km kn kp kr kw ky kz "
+    "la lb lc li lk lr ls lt lu lv ly "
+    "ma mc md mg mh mk ml mm mn mo mp mq mr ms mt mu mv mw mx my mz "
+    "na nc ne nf ng ni nl no np nr nu nz "
+    "om "
+    "pa pe pf pg ph pk pl pm pn pr ps pt pw py "
+    "qa "
+    "re ro ru rw "
+    "sa sb sc sd se sg sh si sj sk sl sm sn so sr st su sv sy sz "
+    "tc td tf tg th tj tk tm tn to tp tr tt tv tw tz "
+    "ua ug uk um us uy uz "
+    "va vc ve vg vi vn vu "
+    "wf ws "
+    "ye yt yu "
+    "za zm zw "
+    "aero arpa biz com coop edu info int gov local mil museum name net org pro";
+
+
+struct UrlClassifierPrivate
+{
+    UrlClassifierPrivate()
+    {
+        Q_FOREACH(const QString & tld, QString::fromLatin1(TOP_LEVEL_DOMAINS).split(QL1C(' ')))
+        {
+            topLevelDomains.insert(tld);
+        }
+
+        Q_FOREACH(const QString & protocol, KProtocolInfo::protocols())
+        {
+            protocols.insert(protocol.toLower());
+        }
+        protocols.insert(QL1S("javascript"));
+    }
+
+    QSet<QString> topLevelDomains;
+    QSet<QString> protocols;
+};
+
+
+K_GLOBAL_STATIC(UrlClassifierPrivate, d)
+
+
+// ------------------------------------------------------------------------------------------
+
+
+static inline bool isHostChar(const QChar &c)
+{
+    return c.isLetterOrNumber() || c == QL1C('-') || c == QL1C('_') || c == QL1C('.');
+}
+
+
+static inline bool isLabelChar(const QChar &c)
+{
+    return c.isLetterOrNumber() || c == QL1C('-');
+}
+
+
+static inline int hexValue(const QChar &c)
+{
+    const ushort u = c.unicode();
+    if (u >= '0' && u <= '9')
+        return u - '0';
+    if (u >= 'a' && u <= 'f')
+        return u - 'a' + 10;
+    if (u >= 'A' && u <= 'F')
+        return u - 'A' + 10;
+    return -1;
+}
+
+
+// 4 dotted decimal numbers, 0 to 255 (leading zeros allowed)
+static bool startsWithIpv4(const QString &text)
+{
+    int i = 0;
+    for (int part = 0; part < 4; ++part)
+    {
+        if (part > 0)
+        {
+            if (i >= text.length() || text.at(i) != QL1C('.'))
+                return false;
+            ++i;
+        }
+
+        const int start = i;
+        int value = 0;
+        while (i < text.length() && text.at(i).isDigit())
+        {
+            value = value * 10 + text.at(i).digitValue();
+            if (value > 255)
+                return false;
+            ++i;
+        }
+
+        if (i == start)
+            return false;
+    }
+
+    // 1.2.3.4567 is not an address
+    return i == text.length() || !text.at(i).isDigit();
+}
+
+
+// 8 groups of (up to 4) hex digits separated by colons. A "::" can stand for the missing groups
+static bool startsWithIpv6(const QString &text)
+{
+    int i = 0;
+    if (i < text.length() && text.at(i) == QL1C('['))
+        ++i;
+
+    int groups = 0;
+    bool compressed = false;
+
+    if (text.mid(i, 2) == QL1S("::"))
+    {
+        compressed = true;
+        i += 2;
+    }
+
+    while (i < text.length() && groups < 8)
+    {
+        int digits = 0;
+        while (i < text.length() && digits < 5 && hexValue(text.at(i)) != -1)
+        {
+            ++digits;
+            ++i;
+        }
+
+        if (digits == 0 || digits > 4)
+            return false;
+        ++groups;
+
+        if (i >= text.length() || text.at(i) != QL1C(':'))
+            break;
+        ++i;
+
+        if (i < text.length() && text.at(i) == QL1C(':'))
+        {
+            if (compressed)
+                return false;
+            compressed = true;
+            ++i;
+        }
+        else if (i == text.length())
+        {
+            // a trailing single colon
+            return false;
+        }
+    }
+
+    return groups == 8 || (compressed && groups < 8);
+}
+
+
+bool UrlClassifier::startsWithIpAddress(const QString &text)
+{
+    return startsWithIpv4(text) || startsWithIpv6(text);
+}
+
+
+bool UrlClassifier::isBrowsable(const QString &text)
+{
+    const QString lower = text.toLower();
+
+    // local paths
+    if (lower.startsWith(QL1C('/')))
+        return true;
+
+    // localhost
+    if (lower.startsWith(QL1S("localhost")))
+    {
+        if (lower.length() == 9 || lower.at(9) == QL1C(':') || lower.at(9) == QL1C('/'))
+            return true;
+    }
+
+    // known protocols: "scheme:"
+    const int colon = lower.indexOf(QL1C(':'));
+    if (colon > 0 && d->protocols.contains(lower.left(colon)))
+        return true;
+
+    if (startsWithIpAddress(lower))
+        return true;
+
+    // addresses: some host chars, a dot and a known top level domain
+    for (int i = 1; i < lower.length(); ++i)
+    {
+        if (lower.at(i) != QL1C('.') || !isHostChar(lower.at(i - 1)))
+            continue;
+
+        int end = i + 1;
+        while (end < lower.length() && isLabelChar(lower.at(end)))
+            ++end;
+
+        if (end > i + 1 && d->topLevelDomains.contains(lower.mid(i + 1, end - i - 1)))
+            return true;
+    }
+
+    return false;
+}
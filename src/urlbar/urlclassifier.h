@@ -0,0 +1,54 @@
+/* ============================================================
+*
+* This file is a part of the rekonq project
+*
+* Copyright (C) 2013 by Andrea Diamantini <adjam7 at gmail dot com>
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* ============================================================ */
+
+
+
+#ifndef URL_CLASSIFIER_H
+#define URL_CLASSIFIER_H
+
+
+// Rekonq Includes
+#include "rekonq_defines.h"
+
+// Qt Includes
+#include <QString>
+
+
+/**
+ * Tells whether the text typed in the url bar looks like something
+ * to browse (an url, an address, a path) rather than something to search.
+ *
+ * It replaces a (huge) regexp: protocols and top level domains are
+ * loaded once in hash sets, ip addresses are parsed by hand.
+ *
+ */
+namespace UrlClassifier
+{
+REKONQ_TESTS_EXPORT bool isBrowsable(const QString &text);
+
+REKONQ_TESTS_EXPORT bool startsWithIpAddress(const QString &text);
+}
+
+#endif // URL_CLASSIFIER_H
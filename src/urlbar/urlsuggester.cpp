@@ -31,13 +31,14 @@
 // Local Includes
 #include "historymanager.h"
 #include "bookmarkmanager.h"
+#include "bookmarkindex.h"
 
 #include "searchengine.h"
+#include "urlclassifier.h"
 
 // KDE Includes
 #include <KBookmark>
 #include <KService>
-#include <KProtocolInfo>
 
 // Qt Includes
 #include <QByteArray>
@@ -56,77 +57,51 @@
 
 
 // NOTE
-// Induce an order in the history items
-bool isHistoryItemRelevant(const HistoryItem &a, const HistoryItem &b)
+// The const int here decides the number of proper suggestions, taken from history & bookmarks
+// You have to add here the "browse & search" options, always available.
+static const int AVAILABLE_ENTRIES = 8;
+
+
+// NOTE
+// A suggestion is the "relevant" one when its url or host starts with the typed text
+static bool isUrlRelevant(const QString &url, const QString &typedString)
 {
-    return a.relevance() > b.relevance();
+    QString hst = KUrl(url).host();
+    return url.startsWith(typedString)
+           || hst.startsWith(typedString)
+           || hst.remove("www.").startsWith(typedString);
 }
 
 
 // ------------------------------------------------------------------------
 
 
-QRegExp UrlSuggester::_browseRegexp;
-QRegExp UrlSuggester::_searchEnginesRegexp;
-
-
 UrlSuggester::UrlSuggester(const QString &typedUrl)
     : QObject()
     , _typedString(typedUrl.trimmed())
     , _isKDEShortUrl(false)
+    , _hasSlowSuggestions(false)
 {
-    if (_browseRegexp.isEmpty())
-    {
-        QString protocol = QString("^(%1)").arg(KProtocolInfo::protocols().join("|"));
-        protocol += QL1S("|javascript");
-        
-        QString localhost = QL1S("^localhost");
-
-        QString local = QL1S("^/");
-
-        QString ipv4 = QL1S("^0*([1-9]?\\d|1\\d\\d|2[0-4]\\d|25[0-5])\\.0*([1-9]?\\d|1\\d\\d|2[0-4]\\d|25[0-5])"\
-                            "\\.0*([1-9]?\\d|1\\d\\d|2[0-4]\\d|25[0-5])\\.0*([1-9]?\\d|1\\d\\d|2[0-4]\\d|25[0-5])");
-
-        QString ipv6 = QL1S("^([0-9a-fA-F]{4}|0)(\\:([0-9a-fA-F]{4}|0)){7}");
-
-        QString address = QL1S("[\\d\\w-.]+\\.(a[cdefgilmnoqrstuwz]|b[abdefghijmnorstvwyz]|"\
-                               "c[acdfghiklmnoruvxyz]|d[ejkmnoz]|e[ceghrstu]|f[ijkmnor]|g[abdefghilmnpqrstuwy]|"\
-                               "h[kmnrtu]|i[delmnoqrst]|j[emop]|k[eghimnprwyz]|l[abcikrstuvy]|"\
-                               "m[acdghklmnopqrstuvwxyz]|n[acefgilopruz]|om|p[aefghklmnrstwy]|qa|r[eouw]|"\
-                               "s[abcdeghijklmnortuvyz]|t[cdfghjkmnoprtvwz]|u[augkmsyz]|v[aceginu]|w[fs]|"\
-                               "y[etu]|z[amw]|aero|arpa|biz|com|coop|edu|info|int|gov|local|mil|museum|name|net|org|"\
-                               "pro)");
-
-        QString joiner = QL1S(")|(");
-        _browseRegexp = QRegExp(QL1C('(') +
-                                protocol + joiner +
-                                localhost + joiner +
-                                local + joiner +
-                                address + joiner +
-                                ipv6 + joiner +
-                                ipv4 + QL1C(')')
-                               );
-    }
-
-    if (_searchEnginesRegexp.isEmpty())
-    {
-        QString reg;
-        QString engineUrl;
-        Q_FOREACH(KService::Ptr s, SearchEngine::favorites())
-        {
-            engineUrl = QRegExp::escape(s->property("Query").toString()).replace(QL1S("\\\\\\{@\\}"), QL1S("[\\d\\w-.]+"));
-            if (reg.isEmpty())
-                reg = QL1C('(') + engineUrl + QL1C(')');
-            else
-                reg = reg + QL1S("|(") + engineUrl + QL1C(')');
-        }
-        _searchEnginesRegexp = QRegExp(reg);
-    }
+    // NOTE: be sure the managers live in the GUI thread,
+    // slow suggestions can be computed elsewhere
+    HistoryManager::self();
+    BookmarkManager::self();
 }
 
 
 // UrlSuggestionList UrlSuggester::orderedSearchItems()
 UrlSuggestionList UrlSuggester::computeSuggestions()
+{
+    UrlSuggestionList list = computeFastSuggestions();
+    if (!_hasSlowSuggestions)
+        return list;
+
+    computeSlowSuggestions();
+    return orderLists();
+}
+
+
+UrlSuggestionList UrlSuggester::computeFastSuggestions()
 {
     if (_typedString.startsWith(QL1S("rekonq:")))
     {
@@ -164,27 +139,31 @@ UrlSuggestionList UrlSuggester::computeSuggestions()
         return _webSearches;
     }
 
-    //compute lists
-    computeHistory();
     computeQurlFromUserInput();
-    computeBookmarks();
+
+    // history & bookmarks will come later
+    _hasSlowSuggestions = true;
 
     return orderLists();
 }
 
 
+// NOTE: this can run in a worker thread
+void UrlSuggester::computeSlowSuggestions()
+{
+    computeHistory();
+    computeBookmarks();
+}
+
+
 UrlSuggestionList UrlSuggester::orderLists()
 {
-    // NOTE
-    // The const int here decides the number of proper suggestions, taken from history & bookmarks
-    // You have to add here the "browse & search" options, always available.
-    const int availableEntries = 8;
+    const int availableEntries = AVAILABLE_ENTRIES;
 
     // Browse & Search results
     UrlSuggestionList browseSearch;
-    QString lowerTypedString = _typedString.toLower();
 
-    bool textIsUrl = (_browseRegexp.indexIn(lowerTypedString) != -1);
+    bool textIsUrl = UrlClassifier::isBrowsable(_typedString);
 
     if (textIsUrl)
     {
@@ -206,10 +185,7 @@ UrlSuggestionList UrlSuggester::orderLists()
     // history
     Q_FOREACH(const UrlSuggestionItem & item, _history)
     {
-        QString hst = KUrl(item.url).host();
-        if (item.url.startsWith(_typedString)
-                || hst.startsWith(_typedString)
-                || hst.remove("www.").startsWith(_typedString))
+        if (isUrlRelevant(item.url, _typedString))
         {
             relevant << item;
             _history.removeOne(item);
@@ -224,10 +200,7 @@ UrlSuggestionList UrlSuggester::orderLists()
         // bookmarks
         Q_FOREACH(const UrlSuggestionItem & item, _bookmarks)
         {
-            QString hst = KUrl(item.url).host();
-            if (item.url.startsWith(_typedString)
-                    || hst.startsWith(_typedString)
-                    || hst.remove("www.").startsWith(_typedString))
+            if (isUrlRelevant(item.url, _typedString))
             {
                 relevant << item;
                 _bookmarks.removeOne(item);
@@ -334,31 +307,57 @@ void UrlSuggester::computeWebSearches()
 // history
 void UrlSuggester::computeHistory()
 {
-    QList<HistoryItem> found = HistoryManager::self()->find(_typedString);
-
-    // FIXME: profiling computeHistory, this seems too much expensive (around 1 second for)
-    // doing it just from second time...
-    if (_typedString.count() > 1)
-        qSort(found.begin(), found.end(), isHistoryItemRelevant);
+    QList<qreal> relevances;
+    //filter all urls that are search engine results
+    QList<HistoryItem> found = HistoryManager::self()->find(_typedString, &relevances, true);
 
-    Q_FOREACH(const HistoryItem & i, found)
+    // NOTE
+    // orderLists() shows at most AVAILABLE_ENTRIES history items, plus the most relevant
+    // one that starts with the typed string. There is no need to sort all the results:
+    // just keep the best ones, ordered by relevance, and that one.
+    QList<int> best;
+    int bestRelevant = -1;
+    for (int i = 0; i < found.count(); ++i)
     {
-        if (_searchEnginesRegexp.isEmpty() || _searchEnginesRegexp.indexIn(i.url) == -1) //filter all urls that are search engine results
+        const HistoryItem &item = found.at(i);
+        const qreal relevance = relevances.at(i);
+
+        int pos = best.count();
+        while (pos > 0 && relevances.at(best.at(pos - 1)) < relevance)
+            --pos;
+        if (pos < AVAILABLE_ENTRIES)
+        {
+            best.insert(pos, i);
+            if (best.count() > AVAILABLE_ENTRIES)
+                best.removeLast();
+        }
+
+        if ((bestRelevant == -1 || relevances.at(bestRelevant) < relevance)
+                && isUrlRelevant(item.url, _typedString))
         {
-            UrlSuggestionItem gItem(UrlSuggestionItem::History, i.url, i.title);
-            _history << gItem;
+            bestRelevant = i;
         }
     }
+
+    if (bestRelevant != -1 && !best.contains(bestRelevant))
+        best << bestRelevant;
+
+    Q_FOREACH(int i, best)
+    {
+        const HistoryItem &item = found.at(i);
+        UrlSuggestionItem gItem(UrlSuggestionItem::History, item.url, item.title);
+        _history << gItem;
+    }
 }
 
 
 // bookmarks
 void UrlSuggester::computeBookmarks()
 {
-    QList<KBookmark> found = BookmarkManager::self()->find(_typedString);
-    Q_FOREACH(const KBookmark & b, found)
+    QList<BookmarkMatch> found = BookmarkManager::self()->match(_typedString);
+    Q_FOREACH(const BookmarkMatch & b, found)
     {
-        UrlSuggestionItem gItem(UrlSuggestionItem::Bookmark, b.url().url(), b.fullText());
+        UrlSuggestionItem gItem(UrlSuggestionItem::Bookmark, b.url, b.text);
         _bookmarks << gItem;
     }
 }
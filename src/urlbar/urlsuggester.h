@@ -106,6 +106,21 @@ public:
 
     UrlSuggestionList computeSuggestions();
 
+    /**
+     * Suggestions can be computed in two steps: the "fast" ones (browse & search)
+     * and the ones from history and bookmarks, that can be computed in a worker thread.
+     * After the slow ones, call orderLists() to have all the suggestions.
+     */
+    UrlSuggestionList computeFastSuggestions();
+    void computeSlowSuggestions();
+
+    bool hasSlowSuggestions() const
+    {
+        return _hasSlowSuggestions;
+    }
+
+    UrlSuggestionList orderLists();
+
 private:
     void computeWebSearches();
     void computeHistory();
@@ -114,8 +129,6 @@ private:
 
     void removeBookmarksDuplicates();
 
-    UrlSuggestionList orderLists();
-
     QString _typedString;
 
     UrlSuggestionList _webSearches;
@@ -125,9 +138,7 @@ private:
     UrlSuggestionList _suggestions;
 
     bool _isKDEShortUrl;
-
-    static QRegExp _browseRegexp;
-    static QRegExp _searchEnginesRegexp;
+    bool _hasSlowSuggestions;
 };
 
 // ------------------------------------------------------------------------------
@@ -29,14 +29,11 @@
 #include "websnap.h"
 #include "websnap.moc"
 
-// KDE Includes
-#include <KStandardDirs>
+// Local Includes
+#include "thumbnailstore.h"
 
 // Qt Includes
 #include <QSize>
-#include <QFile>
-
-#include <QCryptographicHash>
 
 #include <QPainter>
 #include <QAction>
@@ -132,13 +129,41 @@ QPixmap WebSnap::renderPagePreview(const QWebPage &page, int w, int h)
 }
 
 
-QString WebSnap::imagePathFromUrl(const QUrl &url)
+QImage WebSnap::captureViewport(const QWebPage &page)
 {
-    QByteArray name = url.toEncoded(QUrl::RemoveScheme | QUrl::RemoveUserInfo | QUrl::StripTrailingSlash);
+    const QSize viewportSize = page.viewportSize();
+    if (viewportSize.isEmpty())
+        return QImage();
+
+    // twice the snap size: enough for a smooth scaling
+    const int w = 2 * defaultWidth;
+    const int h = 2 * defaultHeight;
+    const qreal scale = (0.0 + w) / viewportSize.width();
+
+    QImage capture(w, h, QImage::Format_ARGB32_Premultiplied);
+    capture.fill(Qt::transparent);
+
+    QPainter p(&capture);
+    p.scale(scale, scale);
+    page.mainFrame()->render(&p, QRegion(0, 0, viewportSize.width(), h / scale));
+    p.end();
+
+    return capture;
+}
 
-    QByteArray hashedName = QCryptographicHash::hash(name, QCryptographicHash::Md5).toHex();
 
-    return KStandardDirs::locateLocal("cache", QString("thumbs/") + hashedName + ".png", true);
+void WebSnap::saveSnapshot(const QUrl &url, const QImage &capture)
+{
+    if (capture.isNull())
+        return;
+
+    ThumbnailStore::self()->queueThumbnail(url, capture, QSize(defaultWidth, defaultHeight));
+}
+
+
+QString WebSnap::imagePathFromUrl(const QUrl &url)
+{
+    return ThumbnailStore::self()->thumbnailPath(url);
 }
 
 
@@ -147,9 +172,7 @@ void WebSnap::saveResult(bool ok)
     if (ok)
     {
         QPixmap image = renderPagePreview(m_page, defaultWidth, defaultHeight);
-        QString path = imagePathFromUrl(m_url);
-        QFile::remove(path);
-        image.save(path);
+        ThumbnailStore::self()->saveThumbnail(m_url, image);
     }
 
     emit snapDone(ok);
@@ -160,5 +183,5 @@ void WebSnap::saveResult(bool ok)
 
 bool WebSnap::existsImage(const QUrl &u)
 {
-    return QFile::exists(imagePathFromUrl(u));
+    return !ThumbnailStore::self()->existingThumbnail(u).isEmpty();
 }
@@ -33,6 +33,7 @@
 #include "rekonq_defines.h"
 
 // Qt Includes
+#include <QImage>
 #include <QObject>
 #include <QWebPage>
 #include <QUrl>
@@ -83,6 +84,27 @@ public:
      */
     static QPixmap renderPagePreview(const QWebPage &page, int w = defaultWidth, int h = defaultHeight);
 
+    /**
+     * Cheaply captures what the page is showing: no relayout,
+     * just a paint of the viewport top in a small image.
+     * Use saveSnapshot() to store it as the url snap.
+     *
+     * @param page the page to capture
+     *
+     * @return the captured image (null if the page has no viewport)
+     */
+    static QImage captureViewport(const QWebPage &page);
+
+    /**
+     * Queues a captured image to be scaled and saved as the url snap.
+     * This happens in a worker thread; just the last image queued
+     * for an url is saved.
+     *
+     * @param url the url of the captured page
+     * @param capture the image from captureViewport()
+     */
+    static void saveSnapshot(const QUrl &url, const QImage &capture);
+
     /**
      * Guess the local path where the image for the url provided
      * should be
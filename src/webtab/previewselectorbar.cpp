@@ -35,6 +35,7 @@
 // Local Include
 #include "webpage.h"
 #include "webtab.h"
+#include "thumbnailstore.h"
 #include "websnap.h"
 
 // KDE Includes
@@ -109,9 +110,9 @@ void PreviewSelectorBar::clicked()
         QStringList urls = ReKonfig::previewUrls();
 
         //cleanup the previous image from the cache (useful to refresh the snapshot)
-        QFile::remove(WebSnap::imagePathFromUrl(urls.at(m_previewIndex)));
+        ThumbnailStore::self()->removeThumbnail(KUrl(urls.at(m_previewIndex)));
         QPixmap preview = WebSnap::renderPagePreview(*tab->page());
-        preview.save(WebSnap::imagePathFromUrl(url));
+        ThumbnailStore::self()->saveThumbnail(url, preview);
 
         urls.replace(m_previewIndex, url.toMimeDataString());
         names.replace(m_previewIndex, tab->page()->mainFrame()->title());
@@ -33,6 +33,7 @@
 
 // Local Includes
 #include "searchengine.h"
+#include "historymanager.h"
 
 // KDE Includes
 #include <KIcon>
@@ -92,6 +93,7 @@ void SearchEngineBar::slotRejected()
 void SearchEngineBar::reloadSearchEngineSettingsAndDelete()
 {
     SearchEngine::reload();
+    HistoryManager::self()->updateSearchResults();
 
     deleteLater();
 }
@@ -177,6 +177,8 @@ WebPage::WebPage(bool isPrivateBrowsing, QWidget *parent)
     connect(this, SIGNAL(loadStarted()), this, SLOT(loadStarted()));
     connect(this, SIGNAL(loadFinished(bool)), this, SLOT(loadFinished(bool)));
 
+    // element hiding rules are added to the documents of every frame
+    AdBlockManager::self()->applyHidingRules(mainFrame());
     connect(this, SIGNAL(frameCreated(QWebFrame*)), AdBlockManager::self(), SLOT(applyHidingRules(QWebFrame*)));
     
     // protocol handler signals
@@ -188,15 +190,26 @@ WebPage::~WebPage()
 {
     disconnect();
 
-    QPixmap preview = WebSnap::renderPagePreview(*this);
-    QString path = WebSnap::imagePathFromUrl(mainFrame()->url().toString());
-    QFile::remove(path);
-    preview.save(path);
+    // NOTE: the preview is scaled && saved in a worker thread: closing tabs must be fast
+    const QUrl url = mainFrame()->url();
+    if (!url.isEmpty())
+    {
+        if (_snapshot.isNull() || _snapshotUrl != url)
+            captureSnapshot();
+        WebSnap::saveSnapshot(url, _snapshot);
+    }
     
     kDebug() << "BYE BYE WEBPAGE";
 }
 
 
+void WebPage::captureSnapshot()
+{
+    _snapshot = WebSnap::captureViewport(*this);
+    _snapshotUrl = mainFrame()->url();
+}
+
+
 void WebPage::setWindow(QWidget *w)
 {
     if (!settings()->testAttribute(QWebSettings::PrivateBrowsingEnabled))
@@ -43,6 +43,10 @@
 // KDE Includes
 #include <KWebPage>
 
+// Qt Includes
+#include <QImage>
+#include <QUrl>
+
 
 class REKONQ_TESTS_EXPORT WebPage : public KWebPage
 {
@@ -64,6 +68,12 @@ public:
     bool hasSslValid() const;
 
     WebSslInfo sslInfo();
+
+    /**
+     * Keeps a (cheap) snapshot of what the page shows,
+     * saved as its preview when the page is closed
+     */
+    void captureSnapshot();
     
 public Q_SLOTS:
     void downloadAllContentsWithKGet();
@@ -102,6 +112,9 @@ private:
     bool _networkAnalyzer;
     bool _isOnRekonqPage;
     bool _hasAdBlockedElements;
+
+    QImage _snapshot;
+    QUrl _snapshotUrl;
 };
 
 #endif